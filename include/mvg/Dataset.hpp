@@ -5,6 +5,7 @@
 #include <memory>
 #include <iostream>
 #include <vector>
+#include <string>
 
 #include <Eigen/Dense>
 
@@ -13,36 +14,151 @@ namespace mvg {
   class Dataset {
   public:
     typedef std::shared_ptr<Dataset> Ptr;
-    
+
+    // All samples live in one contiguous block, one sample after the
+    // other. Seen as a column-major matrix this is `dimension() x
+    // count()` (one sample per column); seen as a row-major matrix it
+    // is `count() x dimension()` (one sample per row). Both views
+    // share the same memory.
+    typedef Eigen::Map<Eigen::MatrixXf> MatrixMap;
+    typedef Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> RowMajorMatrixMap;
+    typedef Eigen::Map<Eigen::VectorXf> RowMap;
+
   private:
-    std::vector<Eigen::VectorXf> m_vecData;
+    std::vector<float> m_vecBuffer;
+    unsigned int m_unDimension;
+    unsigned int m_unCount;
+    unsigned int m_unReservedRows;
+    std::vector<std::string> m_vecColumnNames;
+    
+    // Samples that live in memory not owned by this instance (e.g. a
+    // memory-mapped file). `m_shpExternalOwner` keeps that memory
+    // alive for as long as the dataset refers to it.
+    float* m_pfExternal;
+    std::shared_ptr<void> m_shpExternalOwner;
+    
+    float* base() {
+      return (m_pfExternal ? m_pfExternal : m_vecBuffer.data());
+    }
     
+    void detach() {
+      // Copy external samples into our own buffer before modifying
+      // them; the external memory is left untouched.
+      if(m_pfExternal) {
+	m_vecBuffer.assign(m_pfExternal, m_pfExternal + (size_t)m_unCount * m_unDimension);
+	m_pfExternal = nullptr;
+	m_shpExternalOwner = nullptr;
+	
+	if(m_unReservedRows > m_unCount) {
+	  m_vecBuffer.reserve((size_t)m_unReservedRows * m_unDimension);
+	}
+      }
+    }
+
   protected:
   public:
-    Dataset() {
+    Dataset() : m_unDimension(0), m_unCount(0), m_unReservedRows(0), m_pfExternal(nullptr) {
+    }
+
+    Dataset(unsigned int unDimension) : m_unDimension(unDimension), m_unCount(0), m_unReservedRows(0), m_pfExternal(nullptr) {
     }
     
+    Dataset(float* pfExternal, unsigned int unDimension, unsigned int unCount, std::shared_ptr<void> shpExternalOwner)
+      : m_unDimension(unDimension), m_unCount(unCount), m_unReservedRows(0), m_pfExternal(pfExternal), m_shpExternalOwner(shpExternalOwner) {
+    }
+
     ~Dataset() {
     }
-    
+
     unsigned int dimension() {
-      if(m_vecData.size() > 0) {
-	return m_vecData[0].size();
+      return m_unDimension;
+    }
+
+    void reserve(unsigned int unRows) {
+      // If the dimension isn't known yet, the reservation is applied
+      // as soon as the first sample arrives.
+      m_unReservedRows = unRows;
+
+      if(m_unDimension > 0 && !m_pfExternal) {
+	m_vecBuffer.reserve((size_t)unRows * m_unDimension);
       }
+    }
+
+    template<typename Derived>
+      void add(const Eigen::MatrixBase<Derived>& vxData) {
+      if(m_unDimension == 0) {
+	m_unDimension = vxData.size();
+	this->reserve(m_unReservedRows);
+      }
+
+      this->detach();
       
-      return 0;
+      size_t szOffset= m_vecBuffer.size();
+      m_vecBuffer.resize(szOffset + m_unDimension);
+      RowMap(&m_vecBuffer[szOffset], m_unDimension) = vxData;
+      m_unCount++;
+    }
+
+    bool append(const float* pfData, unsigned int unRows) {
+      // Bulk-append `unRows` samples stored back to back in `pfData`;
+      // requires the dimension to be known.
+      if(m_unDimension == 0) {
+	return false;
+      }
+
+      this->detach();
+      m_vecBuffer.insert(m_vecBuffer.end(), pfData, pfData + (size_t)unRows * m_unDimension);
+      m_unCount += unRows;
+
+      return true;
+    }
+
+    unsigned int count() {
+      return m_unCount;
+    }
+
+    bool isExternal() {
+      return m_pfExternal != nullptr;
     }
     
-    void add(Eigen::VectorXf vxData) {
-      m_vecData.push_back(vxData);
+    void setColumnNames(std::vector<std::string> vecColumnNames) {
+      m_vecColumnNames = vecColumnNames;
     }
     
-    unsigned int count() {
-      return m_vecData.size();
+    std::vector<std::string> columnNames() {
+      return m_vecColumnNames;
+    }
+    
+    float* data() {
+      return this->base();
+    }
+
+    MatrixMap matrix() {
+      return MatrixMap(this->base(), m_unDimension, m_unCount);
+    }
+
+    RowMajorMatrixMap rowMajorMatrix() {
+      return RowMajorMatrixMap(this->base(), m_unCount, m_unDimension);
+    }
+
+    RowMap row(unsigned int unIndex) {
+      return RowMap(this->base() + (size_t)unIndex * m_unDimension, m_unDimension);
+    }
+
+    RowMap operator[](unsigned int unIndex) {
+      return this->row(unIndex);
+    }
+
+    // The same views with the dimension known at compile time; `Dim`
+    // has to match `dimension()` (or be `Eigen::Dynamic`).
+    template<int Dim>
+      Eigen::Map<Eigen::Matrix<float, Dim, Eigen::Dynamic>> fixedMatrix() {
+      return Eigen::Map<Eigen::Matrix<float, Dim, Eigen::Dynamic>>(this->base(), m_unDimension, m_unCount);
     }
     
-    Eigen::VectorXf& operator[](unsigned int unIndex) {
-      return m_vecData[unIndex];
+    template<int Dim>
+      Eigen::Map<Eigen::Matrix<float, Dim, 1>> fixedRow(unsigned int unIndex) {
+      return Eigen::Map<Eigen::Matrix<float, Dim, 1>>(this->base() + (size_t)unIndex * m_unDimension, m_unDimension);
     }
     
     template<class ... Args>
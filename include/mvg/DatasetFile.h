@@ -0,0 +1,76 @@
+#ifndef __DATASETFILE_H__
+#define __DATASETFILE_H__
+
+
+#include <memory>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+#include <mvg/Dataset.hpp>
+
+
+namespace mvg {
+  // Loading and storing of datasets. Besides the text formats used so
+  // far (CSV with a header line, and JSON documents holding one array
+  // per line) there is a compact binary format that can be mapped
+  // into memory and used as a `Dataset` without parsing or copying:
+  //
+  //   Header (32 bytes, native byte order)
+  //     char[4]  magic ("MVGD")
+  //     uint32   format version
+  //     uint32   scalar type (0 = float32, 1 = float64)
+  //     uint32   dimension
+  //     uint64   row count
+  //     uint32   size of the column name block in bytes
+  //     uint32   offset of the sample data from the start of the file
+  //   Column names, each terminated by '\0'
+  //   Padding up to the data offset (a multiple of 64 bytes)
+  //   Samples, one row after the other
+  class DatasetFile {
+  public:
+    typedef enum {
+      Float32 = 0,
+      Float64 = 1
+    } ScalarType;
+    
+    typedef struct {
+      char acMagic[4];
+      uint32_t unVersion;
+      uint32_t unScalarType;
+      uint32_t unDimension;
+      uint64_t ulCount;
+      uint32_t unNamesSize;
+      uint32_t unDataOffset;
+    } Header;
+  
+  private:
+    static std::vector<float> selectColumns(std::vector<float> vecRow, std::vector<unsigned int> vecUsedIndices);
+  
+  protected:
+  public:
+    static Dataset::Ptr loadCSV(std::string strFilepath, std::vector<unsigned int> vecUsedIndices = {});
+    static Dataset::Ptr loadJSONLines(std::string strFilepath, std::vector<unsigned int> vecUsedIndices = {});
+    
+    static bool isBinary(std::string strFilepath);
+    static bool writeBinary(Dataset::Ptr dsData, std::string strFilepath);
+    static Dataset::Ptr mapBinary(std::string strFilepath);
+    
+    // Picks the reader by content (binary) or extension (`.json` for
+    // JSON lines, CSV otherwise). Binary files are mapped without
+    // copying unless a column subset is requested.
+    static Dataset::Ptr load(std::string strFilepath, std::vector<unsigned int> vecUsedIndices = {});
+    
+    // Copy of the used columns (and their names) of a dataset; the
+    // dataset itself if all columns are used.
+    static Dataset::Ptr selectColumns(Dataset::Ptr dsData, std::vector<unsigned int> vecUsedIndices);
+    
+    static bool convertCSV(std::string strFileIn, std::string strFileOut, std::vector<unsigned int> vecUsedIndices = {});
+    static bool convertJSONLines(std::string strFileIn, std::string strFileOut, std::vector<unsigned int> vecUsedIndices = {});
+  };
+}
+
+
+#endif /* __DATASETFILE_H__ */
@@ -0,0 +1,76 @@
+#ifndef __GRID_HPP__
+#define __GRID_HPP__
+
+
+#include <memory>
+#include <iostream>
+#include <cmath>
+
+
+namespace mvg {
+  // Regular two dimensional grid of sample points. Cell (unX, unY) is
+  // located at (x(unX), y(unY)); rasterized values are stored with
+  // the y index running fastest, i.e. at `unX * unCountY + unY`.
+  class Grid {
+  public:
+    float fOriginX;
+    float fOriginY;
+    float fStepX;
+    float fStepY;
+    unsigned int unCountX;
+    unsigned int unCountY;
+  
+  private:
+    static unsigned int steps(float fMin, float fMax, float fStep, bool bInclusive) {
+      double dSteps = ((double)fMax - (double)fMin) / (double)fStep;
+      
+      if(dSteps < 0) {
+	return (bInclusive && dSteps > -1e-4 ? 1 : 0);
+      }
+      
+      if(bInclusive) {
+	return (unsigned int)floor(dSteps + 1e-4) + 1;
+      }
+      
+      return (unsigned int)ceil(dSteps - 1e-4);
+    }
+  
+  protected:
+  public:
+    Grid() : fOriginX(0), fOriginY(0), fStepX(1), fStepY(1), unCountX(0), unCountY(0) {
+    }
+    
+    ~Grid() {
+    }
+    
+    // The grid `for(x = min; x < max; x += step)` would visit; with
+    // `bInclusive`, the maximum itself is part of the grid as well.
+    static Grid fromBoundingBox(float fMinX, float fMinY, float fMaxX, float fMaxY, float fStepX, float fStepY, bool bInclusive = false) {
+      Grid grdGrid;
+      
+      grdGrid.fOriginX = fMinX;
+      grdGrid.fOriginY = fMinY;
+      grdGrid.fStepX = fStepX;
+      grdGrid.fStepY = fStepY;
+      grdGrid.unCountX = steps(fMinX, fMaxX, fStepX, bInclusive);
+      grdGrid.unCountY = steps(fMinY, fMaxY, fStepY, bInclusive);
+      
+      return grdGrid;
+    }
+    
+    float x(unsigned int unX) {
+      return fOriginX + unX * fStepX;
+    }
+    
+    float y(unsigned int unY) {
+      return fOriginY + unY * fStepY;
+    }
+    
+    unsigned int size() {
+      return unCountX * unCountY;
+    }
+  };
+}
+
+
+#endif /* __GRID_HPP__ */
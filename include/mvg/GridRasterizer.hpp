@@ -0,0 +1,403 @@
+#ifndef __GRIDRASTERIZER_HPP__
+#define __GRIDRASTERIZER_HPP__
+
+
+#include <memory>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <Eigen/Dense>
+
+#include <mvg/Grid.hpp>
+#include <mvg/Parallel.h>
+#include <mvg/MultiVarGauss.hpp>
+#include <mvg/MixedGaussians.hpp>
+
+
+namespace mvg {
+  // Evaluates (weighted sums of) Gaussians on every cell of a `Grid`.
+  //
+  // The grid spans the plane of two data dimensions (`unAxisX`,
+  // `unAxisY`). Without an anchor, the marginal density of those two
+  // dimensions is rasterized; with an anchor (one value per data
+  // dimension), the density is sliced through the anchor point
+  // instead, with the grid replacing the anchor's values along the
+  // two axes.
+  //
+  // Within one grid row (fixed x), the exponent of a Gaussian is a
+  // quadratic polynomial in the y index, so it is advanced from cell
+  // to cell with two additions (forward differences) rather than by
+  // evaluating the quadratic form; only the final `exp` is done per
+  // cell, vectorized over the whole row.
+  //
+  // With a tolerance set, rows are cut into tiles of `TileColumns`
+  // cells, and a term is skipped on a tile if its largest value there
+  // is below `tolerance` times a lower bound of the tile's total
+  // (the largest of the terms' smallest values). Both bounds are exact
+  // extrema of the term's quadratic over the tile, so every cell's
+  // relative error stays below the sum of the skipped terms' ratios,
+  // which `errorBound()` reports for the last rasterization.
+  template<typename T>
+  class GridRasterizer {
+  public:
+    typedef std::shared_ptr<GridRasterizer> Ptr;
+  
+  private:
+    // One weighted Gaussian restricted to the grid: in cell (i, j),
+    // log(w * N) = dLogScale - q / 2 where
+    //   q = dA * j^2 + (dB0 + dB1 * i) * j + dC0 + dC1 * i + dC2 * i^2
+    typedef struct {
+      double dLogScale;
+      double dA;
+      double dB0;
+      double dB1;
+      double dC0;
+      double dC1;
+      double dC2;
+    } Term;
+    
+    Grid m_grdGrid;
+    unsigned int m_unAxisX;
+    unsigned int m_unAxisY;
+    std::vector<float> m_vecAnchor;
+    std::vector<Term> m_vecTerms;
+    double m_dTolerance;
+    double m_dErrorBound;
+    
+    void exponents(Term& trmTerm, unsigned int unX, unsigned int unFirstY, unsigned int unCount, float* pfExponents) {
+      // log(w * N) of the term along row `unX`, for the `unCount` cells
+      // starting at `unFirstY`.
+      double dX = unX;
+      double dY = unFirstY;
+      double dQ = this->quadratic(trmTerm, dX, dY);
+      double dDelta = trmTerm.dA * (2 * dY + 1) + trmTerm.dB0 + trmTerm.dB1 * dX;
+      double dDeltaStep = 2 * trmTerm.dA;
+      
+      for(unsigned int unY = 0; unY < unCount; ++unY) {
+	pfExponents[unY] = trmTerm.dLogScale - 0.5 * dQ;
+	dQ += dDelta;
+	dDelta += dDeltaStep;
+      }
+    }
+    
+    double quadratic(Term& trmTerm, double dX, double dY) {
+      return trmTerm.dA * dY * dY + (trmTerm.dB0 + trmTerm.dB1 * dX) * dY + trmTerm.dC0 + (trmTerm.dC1 + trmTerm.dC2 * dX) * dX;
+    }
+    
+    double minimumQuadratic(Term& trmTerm, double dX0, double dX1, double dY0, double dY1) {
+      // q is convex (dA, dC2 > 0 and a positive definite Hessian): the
+      // minimum over the box is the stationary point if that lies
+      // inside, and otherwise the smallest of the edge minima.
+      double dDeterminant = 4 * trmTerm.dA * trmTerm.dC2 - trmTerm.dB1 * trmTerm.dB1;
+      
+      if(dDeterminant > 0) {
+	double dX = (trmTerm.dB1 * trmTerm.dB0 - 2 * trmTerm.dA * trmTerm.dC1) / dDeterminant;
+	double dY = (trmTerm.dB1 * trmTerm.dC1 - 2 * trmTerm.dC2 * trmTerm.dB0) / dDeterminant;
+	
+	if(dX >= dX0 && dX <= dX1 && dY >= dY0 && dY <= dY1) {
+	  return this->quadratic(trmTerm, dX, dY);
+	}
+      }
+      
+      double dMinimum = std::numeric_limits<double>::infinity();
+      
+      for(double dX : {dX0, dX1}) {
+	double dY = std::min(std::max(-(trmTerm.dB0 + trmTerm.dB1 * dX) / (2 * trmTerm.dA), dY0), dY1);
+	dMinimum = std::min(dMinimum, this->quadratic(trmTerm, dX, dY));
+      }
+      
+      for(double dY : {dY0, dY1}) {
+	double dX = std::min(std::max(-(trmTerm.dC1 + trmTerm.dB1 * dY) / (2 * trmTerm.dC2), dX0), dX1);
+	dMinimum = std::min(dMinimum, this->quadratic(trmTerm, dX, dY));
+      }
+      
+      return dMinimum;
+    }
+    
+    double maximumQuadratic(Term& trmTerm, double dX0, double dX1, double dY0, double dY1) {
+      // Convex, so the maximum is at a corner
+      return std::max(std::max(this->quadratic(trmTerm, dX0, dY0), this->quadratic(trmTerm, dX0, dY1)),
+		      std::max(this->quadratic(trmTerm, dX1, dY0), this->quadratic(trmTerm, dX1, dY1)));
+    }
+    
+    double activeTerms(unsigned int unFirstX, unsigned int unRows, unsigned int unFirstY, unsigned int unColumns, std::vector<unsigned int>& vecActive) {
+      // Terms that matter on the tile; returns the relative error
+      // bound of leaving out the others.
+      vecActive.clear();
+      
+      if(m_dTolerance <= 0 || m_vecTerms.size() <= 1) {
+	for(unsigned int unTerm = 0; unTerm < m_vecTerms.size(); ++unTerm) {
+	  vecActive.push_back(unTerm);
+	}
+	
+	return 0.0;
+      }
+      
+      double dX0 = unFirstX, dX1 = unFirstX + unRows - 1;
+      double dY0 = unFirstY, dY1 = unFirstY + unColumns - 1;
+      std::vector<double> vecUpper(m_vecTerms.size());
+      double dLower = -std::numeric_limits<double>::infinity();
+      double dErrorBound = 0.0;
+      
+      for(unsigned int unTerm = 0; unTerm < m_vecTerms.size(); ++unTerm) {
+	Term& trmTerm = m_vecTerms[unTerm];
+	
+	vecUpper[unTerm] = trmTerm.dLogScale - 0.5 * this->minimumQuadratic(trmTerm, dX0, dX1, dY0, dY1);
+	dLower = std::max(dLower, trmTerm.dLogScale - 0.5 * this->maximumQuadratic(trmTerm, dX0, dX1, dY0, dY1));
+      }
+      
+      double dThreshold = dLower + log(m_dTolerance);
+      
+      for(unsigned int unTerm = 0; unTerm < m_vecTerms.size(); ++unTerm) {
+	if(vecUpper[unTerm] >= dThreshold) {
+	  vecActive.push_back(unTerm);
+	} else {
+	  dErrorBound += exp(vecUpper[unTerm] - dLower);
+	}
+      }
+      
+      return dErrorBound;
+    }
+  
+  protected:
+  public:
+    GridRasterizer(Grid grdGrid, unsigned int unAxisX = 0, unsigned int unAxisY = 1, std::vector<float> vecAnchor = {})
+      : m_grdGrid(grdGrid), m_unAxisX(unAxisX), m_unAxisY(unAxisY), m_vecAnchor(vecAnchor), m_dTolerance(0.0), m_dErrorBound(0.0) {
+    }
+    
+    ~GridRasterizer() {
+    }
+    
+    Grid& grid() {
+      return m_grdGrid;
+    }
+    
+    // Relative contribution below which terms are skipped per tile; 0
+    // (the default) evaluates every term everywhere.
+    void setTolerance(double dTolerance) {
+      m_dTolerance = dTolerance;
+    }
+    
+    double tolerance() {
+      return m_dTolerance;
+    }
+    
+    // Largest relative error a cell of the last `rasterize()` or
+    // `rasterizeLog()` call may have due to skipped terms.
+    double errorBound() {
+      return m_dErrorBound;
+    }
+    
+    template<int Dim>
+      void addGaussian(MultiVarGauss<T, Dim>& mvgGaussian, double dWeight = 1.0) {
+      typename MultiVarGauss<T, Dim>::Model& mdlModel = mvgGaussian.model();
+      unsigned int unSize = mdlModel.vxMean.size();
+      
+      if(!mdlModel.bValid || dWeight <= 0) {
+	return;
+      }
+      
+      if(m_unAxisX >= unSize || m_unAxisY >= unSize || (m_vecAnchor.size() > 0 && m_vecAnchor.size() != unSize)) {
+	std::cerr << "Grid axes don't match a " << unSize << " dimensional Gaussian" << std::endl;
+	return;
+      }
+      
+      // Quadratic form in plane coordinates relative to the grid
+      // origin: q(d) = d^T P d + 2 d^T b + c
+      Eigen::MatrixXd mxL = mdlModel.mxCholesky.template cast<double>();
+      Eigen::Matrix2d mxPrecision;
+      Eigen::Vector2d vxLinear;
+      double dConstant;
+      double dLogNormalization;
+      
+      if(m_vecAnchor.size() == 0) {
+	Eigen::MatrixXd mxCov = mxL * mxL.transpose();
+	Eigen::Matrix2d mxCovPlane;
+	mxCovPlane << mxCov(m_unAxisX, m_unAxisX), mxCov(m_unAxisX, m_unAxisY),
+	  mxCov(m_unAxisY, m_unAxisX), mxCov(m_unAxisY, m_unAxisY);
+	
+	Eigen::Vector2d vxDiff(m_grdGrid.fOriginX - mdlModel.vxMean[m_unAxisX], m_grdGrid.fOriginY - mdlModel.vxMean[m_unAxisY]);
+	
+	mxPrecision = mxCovPlane.inverse();
+	vxLinear = mxPrecision * vxDiff;
+	dConstant = vxDiff.dot(vxLinear);
+	dLogNormalization = -0.5 * (2 * log(2 * M_PI) + log(mxCovPlane.determinant()));
+      } else {
+	Eigen::MatrixXd mxLInverse = mxL.triangularView<Eigen::Lower>().solve(Eigen::MatrixXd::Identity(unSize, unSize));
+	Eigen::MatrixXd mxFullPrecision = mxLInverse.transpose() * mxLInverse;
+	
+	Eigen::VectorXd vxDiff(unSize);
+	for(unsigned int unI = 0; unI < unSize; ++unI) {
+	  vxDiff[unI] = m_vecAnchor[unI] - mdlModel.vxMean[unI];
+	}
+	
+	vxDiff[m_unAxisX] = m_grdGrid.fOriginX - mdlModel.vxMean[m_unAxisX];
+	vxDiff[m_unAxisY] = m_grdGrid.fOriginY - mdlModel.vxMean[m_unAxisY];
+	
+	Eigen::VectorXd vxFullLinear = mxFullPrecision * vxDiff;
+	
+	mxPrecision << mxFullPrecision(m_unAxisX, m_unAxisX), mxFullPrecision(m_unAxisX, m_unAxisY),
+	  mxFullPrecision(m_unAxisY, m_unAxisX), mxFullPrecision(m_unAxisY, m_unAxisY);
+	vxLinear << vxFullLinear[m_unAxisX], vxFullLinear[m_unAxisY];
+	dConstant = vxDiff.dot(vxFullLinear);
+	dLogNormalization = mdlModel.fLogNormalization;
+      }
+      
+      if(!std::isfinite(dLogNormalization)) {
+	return;
+      }
+      
+      double dStepX = m_grdGrid.fStepX;
+      double dStepY = m_grdGrid.fStepY;
+      
+      Term trmTerm;
+      trmTerm.dLogScale = log(dWeight) + dLogNormalization;
+      trmTerm.dA = dStepY * dStepY * mxPrecision(1, 1);
+      trmTerm.dB0 = 2 * dStepY * vxLinear[1];
+      trmTerm.dB1 = 2 * dStepX * dStepY * mxPrecision(0, 1);
+      trmTerm.dC0 = dConstant;
+      trmTerm.dC1 = 2 * dStepX * vxLinear[0];
+      trmTerm.dC2 = dStepX * dStepX * mxPrecision(0, 0);
+      
+      m_vecTerms.push_back(trmTerm);
+    }
+    
+    template<int Dim>
+      void addMixture(MixedGaussians<T, Dim>& mgMixture) {
+      // Weights normalized as in `MixedGaussians::sample()`
+      double dWeightSum = 0.0;
+      for(typename MixedGaussians<T, Dim>::Gaussian& gsGaussian : mgMixture.gaussians()) {
+	dWeightSum += std::max(gsGaussian.dWeight, 0.0);
+      }
+      
+      if(dWeightSum <= 0.0) {
+	return;
+      }
+      
+      for(typename MixedGaussians<T, Dim>::Gaussian& gsGaussian : mgMixture.gaussians()) {
+	this->addGaussian(*gsGaussian.mvgGaussian, gsGaussian.dWeight / dWeightSum);
+      }
+    }
+    
+    double rasterizeRows(unsigned int unFirstX, unsigned int unRows, float* pfDensities) {
+      // Writes rows [unFirstX, unFirstX + unRows) to `pfDensities`,
+      // which points at the first value of row `unFirstX`, and returns
+      // the relative error bound of the skipped terms.
+      unsigned int unCountY = m_grdGrid.unCountY;
+      std::vector<float> vecExponents(TileColumns);
+      std::vector<unsigned int> vecActive;
+      double dErrorBound = 0.0;
+      
+      for(unsigned int unFirstY = 0; unFirstY < unCountY; unFirstY += TileColumns) {
+	unsigned int unColumns = std::min(TileColumns, unCountY - unFirstY);
+	
+	dErrorBound = std::max(dErrorBound, this->activeTerms(unFirstX, unRows, unFirstY, unColumns, vecActive));
+	
+	for(unsigned int unRow = 0; unRow < unRows; ++unRow) {
+	  Eigen::Map<Eigen::ArrayXf> arrCells(pfDensities + (size_t)unRow * unCountY + unFirstY, unColumns);
+	  arrCells.setZero();
+	  
+	  for(unsigned int unTerm : vecActive) {
+	    this->exponents(m_vecTerms[unTerm], unFirstX + unRow, unFirstY, unColumns, vecExponents.data());
+	    arrCells += Eigen::Map<Eigen::ArrayXf>(vecExponents.data(), unColumns).exp();
+	  }
+	}
+      }
+      
+      return dErrorBound;
+    }
+    
+    double rasterizeLogRows(unsigned int unFirstX, unsigned int unRows, float* pfLogDensities) {
+      // Log-domain version of `rasterizeRows()`, combining the terms
+      // with log-sum-exp. With a single term no `exp` is evaluated at
+      // all, which makes this the cheaper choice for maximum searches
+      // on one Gaussian. The bound also holds for the log densities as
+      // an absolute error, since log(1 + e) <= e.
+      unsigned int unCountY = m_grdGrid.unCountY;
+      Eigen::ArrayXXf arrTerms(TileColumns, m_vecTerms.size());
+      std::vector<unsigned int> vecActive;
+      double dErrorBound = 0.0;
+      
+      for(unsigned int unFirstY = 0; unFirstY < unCountY; unFirstY += TileColumns) {
+	unsigned int unColumns = std::min(TileColumns, unCountY - unFirstY);
+	
+	dErrorBound = std::max(dErrorBound, this->activeTerms(unFirstX, unRows, unFirstY, unColumns, vecActive));
+	
+	for(unsigned int unRow = 0; unRow < unRows; ++unRow) {
+	  Eigen::Map<Eigen::ArrayXf> arrCells(pfLogDensities + (size_t)unRow * unCountY + unFirstY, unColumns);
+	  
+	  if(vecActive.size() == 0) {
+	    arrCells.setConstant(-std::numeric_limits<float>::infinity());
+	  } else if(vecActive.size() == 1) {
+	    this->exponents(m_vecTerms[vecActive[0]], unFirstX + unRow, unFirstY, unColumns, arrCells.data());
+	  } else {
+	    auto arrActive = arrTerms.topLeftCorner(unColumns, vecActive.size());
+	    
+	    for(unsigned int unI = 0; unI < vecActive.size(); ++unI) {
+	      this->exponents(m_vecTerms[vecActive[unI]], unFirstX + unRow, unFirstY, unColumns, arrTerms.col(unI).data());
+	    }
+	    
+	    Eigen::ArrayXf arrMax = arrActive.rowwise().maxCoeff();
+	    arrCells = arrMax + (arrActive.colwise() - arrMax).exp().rowwise().sum().log();
+	  }
+	}
+      }
+      
+      return dErrorBound;
+    }
+    
+    // Rows handed to one worker thread at a time by `rasterize()` and
+    // `rasterizeLog()`.
+    static const unsigned int TileRows = 8;
+    // Cells per row of a tile that terms are culled on
+    static const unsigned int TileColumns = 64;
+    
+    void rasterize(float* pfDensities) {
+      // Rows are independent, so tiles of them are rasterized in
+      // parallel, each straight into its place in `pfDensities`.
+      std::vector<double> vecErrorBounds(Parallel::chunks(m_grdGrid.unCountX, TileRows), 0.0);
+      
+      Parallel::forRange(m_grdGrid.unCountX, TileRows, [this, pfDensities, &vecErrorBounds](unsigned int unBegin, unsigned int unEnd) {
+	  vecErrorBounds[unBegin / TileRows] = this->rasterizeRows(unBegin, unEnd - unBegin, pfDensities + (size_t)unBegin * m_grdGrid.unCountY);
+	});
+      
+      m_dErrorBound = (vecErrorBounds.size() > 0 ? *std::max_element(vecErrorBounds.begin(), vecErrorBounds.end()) : 0.0);
+    }
+    
+    void rasterize(std::vector<float>& vecDensities) {
+      vecDensities.resize(m_grdGrid.size());
+      this->rasterize(vecDensities.data());
+    }
+    
+    void rasterizeLog(float* pfLogDensities) {
+      std::vector<double> vecErrorBounds(Parallel::chunks(m_grdGrid.unCountX, TileRows), 0.0);
+      
+      Parallel::forRange(m_grdGrid.unCountX, TileRows, [this, pfLogDensities, &vecErrorBounds](unsigned int unBegin, unsigned int unEnd) {
+	  vecErrorBounds[unBegin / TileRows] = this->rasterizeLogRows(unBegin, unEnd - unBegin, pfLogDensities + (size_t)unBegin * m_grdGrid.unCountY);
+	});
+      
+      m_dErrorBound = (vecErrorBounds.size() > 0 ? *std::max_element(vecErrorBounds.begin(), vecErrorBounds.end()) : 0.0);
+    }
+    
+    void rasterizeLog(std::vector<float>& vecLogDensities) {
+      vecLogDensities.resize(m_grdGrid.size());
+      this->rasterizeLog(vecLogDensities.data());
+    }
+    
+    template<class ... Args>
+      static GridRasterizer::Ptr create(Args ... args) {
+      return std::make_shared<GridRasterizer>(std::forward<Args>(args)...);
+    }
+  };
+  
+  template<typename T>
+    const unsigned int GridRasterizer<T>::TileRows;
+  template<typename T>
+    const unsigned int GridRasterizer<T>::TileColumns;
+}
+
+
+#endif /* __GRIDRASTERIZER_HPP__ */
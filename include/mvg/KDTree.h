@@ -0,0 +1,75 @@
+#ifndef __KDTREE_H__
+#define __KDTREE_H__
+
+
+#include <memory>
+#include <iostream>
+#include <vector>
+#include <utility>
+
+#include <mvg/Dataset.hpp>
+
+
+namespace mvg {
+  // k-d tree over the samples of a dataset. Nodes are split at the
+  // median of their widest dimension until at most `unLeafSize`
+  // samples are left; every node keeps the tight bounding box and the
+  // sum of its samples. Queries return sample indices into the
+  // dataset, which must not change while the tree is in use.
+  class KDTree {
+  public:
+    typedef std::shared_ptr<KDTree> Ptr;
+  
+  private:
+    typedef struct {
+      unsigned int unBegin; // Sample range in `m_vecIndices`
+      unsigned int unEnd;
+      int nLeft; // Child nodes, -1 for leaves
+      int nRight;
+      Eigen::VectorXf vxMin;
+      Eigen::VectorXf vxMax;
+      Eigen::VectorXd vxSum;
+    } Node;
+    
+    Dataset::Ptr m_dsData;
+    unsigned int m_unLeafSize;
+    std::vector<unsigned int> m_vecIndices;
+    std::vector<Node> m_vecNodes;
+    
+    int build(unsigned int unBegin, unsigned int unEnd);
+    float boxDistance(Node& ndNode, const Eigen::VectorXf& vxQuery);
+    void search(int nNode, const Eigen::VectorXf& vxQuery, unsigned int unK, std::vector<std::pair<float, unsigned int>>& vecHeap);
+    void collect(int nNode, const Eigen::VectorXf& vxQuery, float fRadiusSquared, std::vector<unsigned int>& vecResult);
+    void filter(int nNode, const Eigen::MatrixXf& mxCentroids, std::vector<unsigned int> vecCandidates, Eigen::MatrixXd& mxSums, std::vector<unsigned int>& vecCounts, std::vector<unsigned int>& vecLabels);
+  
+  protected:
+  public:
+    KDTree(Dataset::Ptr dsData, unsigned int unLeafSize = 16);
+    ~KDTree();
+    
+    Dataset::Ptr data();
+    
+    // Index of the closest sample (0 for an empty dataset)
+    unsigned int nearest(Eigen::VectorXf vxQuery);
+    // The `unK` closest samples, closest first
+    std::vector<unsigned int> nearest(Eigen::VectorXf vxQuery, unsigned int unK);
+    // All samples within `fRadius`, in no particular order
+    std::vector<unsigned int> radius(Eigen::VectorXf vxQuery, float fRadius);
+    
+    // Assigns every sample the label of its closest centroid (one per
+    // column) and returns the per-centroid sums and counts, using the
+    // filtering algorithm (Kanungo et al.): candidate centroids that
+    // cannot be closest to any point of a node's box are dropped on the
+    // way down, and a node left with one candidate is assigned as a
+    // whole.
+    void assign(const Eigen::MatrixXf& mxCentroids, Eigen::MatrixXd& mxSums, std::vector<unsigned int>& vecCounts, std::vector<unsigned int>& vecLabels);
+    
+    template<class ... Args>
+      static KDTree::Ptr create(Args ... args) {
+      return std::make_shared<KDTree>(std::forward<Args>(args)...);
+    }
+  };
+}
+
+
+#endif /* __KDTREE_H__ */
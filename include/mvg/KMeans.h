@@ -7,11 +7,30 @@
 #include <string>
 #include <fstream>
 #include <map>
+#include <vector>
+#include <random>
 
 #include <mvg/Dataset.hpp>
+#include <mvg/KDTree.h>
+#include <mvg/MultiVarGauss.hpp>
 
 
-extern "C" int* k_means(double**, int, int, int, double, double**);
+// C interface. `k_means_float()` and `k_means_double()` cluster
+// `nRows` samples of `nDimension` values each that the caller stores
+// row after row, and write one label per sample into `pnLabels` and
+// the centroids row after row into `pxCentroids` (either may be NULL).
+// Float data is clustered in place; double data is converted to float
+// once, straight into the buffer that is clustered. The same seed
+// gives the same result. Both return 1 on success and 0 otherwise.
+extern "C" int k_means_float(const float* pfData, int nRows, int nDimension, int nClusters, unsigned long ulSeed, int* pnLabels, float* pfCentroids);
+extern "C" int k_means_double(const double* pdData, int nRows, int nDimension, int nClusters, unsigned long ulSeed, int* pnLabels, double* pdCentroids);
+// Row-pointer interface: `n` samples of `m` values, `k` clusters,
+// iterating until no centroid moves farther than `t` (the `KMeans`
+// default if `t` isn't positive). Returns `malloc()`ed labels (to be
+// `free()`d by the caller) or NULL, and fills `centroids` (k rows of m
+// values) unless it is NULL. Seeding uses a fixed seed, so the same
+// input always gives the same result.
+extern "C" int* k_means(double** data, int n, int m, int k, double t, double** centroids);
 
 
 namespace mvg {
@@ -19,9 +38,100 @@ namespace mvg {
   public:
     typedef std::shared_ptr<KMeans> Ptr;
     
+    // Result of one k-means run: the cluster label of every sample of
+    // the source (in source order) and one centroid per column. With
+    // restarts, it is the run of lowest inertia, and the iterations and
+    // inertia of every restart (in restart order) are kept alongside.
+    typedef struct {
+      std::vector<unsigned int> vecLabels;
+      Eigen::MatrixXf mxCentroids;
+      unsigned int unIterations;
+      double dInertia; // Sum of squared distances to the own centroid
+      unsigned int unRestart;
+      std::vector<unsigned int> vecRestartIterations;
+      std::vector<double> vecRestartInertias;
+    } Clustering;
+    
+    // `Hamerly` skips most distance computations once few samples
+    // change their cluster, with the same result as `Lloyd`.
+    // `MiniBatch` moves the centroids by small random batches only and
+    // trades some accuracy for time on large datasets. `Filtering`
+    // assigns whole k-d tree cells at once (best in few dimensions),
+    // again with the result of `Lloyd`.
+    typedef enum {
+      Lloyd = 0,
+      Hamerly = 1,
+      MiniBatch = 2,
+      Filtering = 3
+    } Algorithm;
+    
+    // How the initial centroids are picked: the first samples, k-means++
+    // (D^2 sampling, one centroid after the other), or k-means|| (D^2
+    // oversampling in a few rounds, reduced to k by weighted k-means++).
+    typedef enum {
+      FirstSamples = 0,
+      KMeansPlusPlus = 1,
+      KMeansParallel = 2
+    } Seeding;
+    
+    // How `silhouettes()` scores a clustering: `Exact` compares every
+    // sample with every other (O(n^2), run in parallel), `Simplified`
+    // measures the distances to the centroids instead (O(n k)), and
+    // `Sampled` is exact within a fixed random subsample.
+    typedef enum {
+      Exact = 0,
+      Simplified = 1,
+      Sampled = 2
+    } Silhouette;
+    
+    // What `calculate(unMinClusters, unMaxClusters)` picks the cluster
+    // count by. All but `AverageSilhouette` come from the per-cluster
+    // sufficient statistics in O(n k).
+    typedef enum {
+      AverageSilhouette = 0,
+      CalinskiHarabasz = 1,
+      DaviesBouldin = 2,
+      BIC = 3
+    } Criterion;
+  
   private:
     Dataset::Ptr m_dsSource;
     std::vector<Dataset::Ptr> m_vecClusters;
+    bool m_bClustersCollected;
+    Clustering m_clClustering;
+    Algorithm m_algAlgorithm;
+    Seeding m_sdSeeding;
+    bool m_bFixedSeed;
+    unsigned long m_ulSeed;
+    std::mt19937 m_mtEngine;
+    unsigned int m_unBatchSize;
+    unsigned int m_unMaxBatches;
+    double m_dBatchTolerance;
+    std::vector<double> m_vecCentroidCounts;
+    Silhouette m_slSilhouette;
+    unsigned int m_unSilhouetteSamples;
+    unsigned long m_ulSilhouetteSeed;
+    unsigned int m_unRestarts;
+    double m_dTolerance;
+    
+    unsigned int drawWeighted(std::vector<double>& vecWeights, double dTotal);
+    void updateDistances(Dataset::Ptr dsData, Eigen::VectorXf vxCentroid, std::vector<double>& vecDistances, double& dTotal);
+    Eigen::MatrixXf seedPlusPlus(Dataset::Ptr dsData, unsigned int unClusters);
+    Eigen::MatrixXf seedParallel(Dataset::Ptr dsData, unsigned int unClusters);
+    Eigen::MatrixXf seed(Dataset::Ptr dsData, unsigned int unClusters);
+    void reseed(Eigen::MatrixXf& mxCentroids);
+    bool moveMeans(Eigen::MatrixXd& mxSums, std::vector<unsigned int>& vecCounts, Eigen::MatrixXf& mxCentroids, Eigen::VectorXd& vxMovement);
+    double inertia(Clustering& clClustering);
+    Clustering lloyd(Eigen::MatrixXf mxCentroids);
+    Clustering hamerly(Eigen::MatrixXf mxCentroids);
+    double miniBatchStep(const Eigen::Ref<const Eigen::MatrixXf>& mxBatch, Eigen::MatrixXf& mxCentroids);
+    Clustering miniBatch(Eigen::MatrixXf mxCentroids);
+    Clustering filtering(Eigen::MatrixXf mxCentroids);
+    Clustering run(unsigned int unClusters);
+    void collectClusters();
+    double silhouetteValue(double dOwnDissimilarity, double dLowestOtherDissimilarity);
+    std::vector<MultiVarGauss<float>> clusterGaussians();
+    double score(Criterion crCriterion, unsigned int unClusters);
     
   protected:
   public:
@@ -29,14 +139,52 @@ namespace mvg {
     ~KMeans();
     
     void setSource(Dataset::Ptr dsSource);
-    bool calculate(unsigned int unMinClusters, unsigned int unMaxClusters);
+    void setAlgorithm(Algorithm algAlgorithm);
+    void setSeeding(Seeding sdSeeding);
+    // Makes runs reproducible: every `calculate()` starts its random
+    // engine from this seed. Without one, a random seed is used.
+    void setSeed(unsigned long ulSeed);
+    // Mini-batch settings: samples per batch, the most batches one
+    // `calculate()` draws, and the relative improvement of the smoothed
+    // batch inertia below which ten batches in a row count as converged.
+    void setMiniBatch(unsigned int unBatchSize, unsigned int unMaxBatches = 100, double dTolerance = 1e-3);
+    // Lloyd, Hamerly and filtering iterations end once no centroid
+    // moves farther than this (default 1e-4).
+    void setTolerance(double dTolerance);
+    // Runs every `calculate()` this many times from differently seeded
+    // initial centroids (concurrently) and keeps the lowest inertia.
+    // Restart 0 is seeded exactly like a single run.
+    void setRestarts(unsigned int unRestarts);
+    void setSilhouette(Silhouette slSilhouette, unsigned int unSamples = 2000, unsigned long ulSeed = 0);
+    bool calculate(unsigned int unMinClusters, unsigned int unMaxClusters, Criterion crCriterion = AverageSilhouette);
     bool calculate(unsigned int unClusters);
     std::vector<Dataset::Ptr> clusters();
     
+    // Streaming mini-batch update with newly arrived samples; the first
+    // batch (or one after a change of `unClusters`) seeds the centroids.
+    // Only the centroids are kept, not the labels of the batch samples;
+    // `clustering().dInertia` is the inertia of the last batch. Labels
+    // and clusters of the source are recomputed from the updated
+    // centroids when next asked for.
+    bool partialFit(Dataset::Ptr dsBatch, unsigned int unClusters);
+    unsigned int closestCentroid(Eigen::VectorXf vxSample);
+    
+    Clustering& clustering();
+    std::vector<unsigned int>& labels();
+    Eigen::MatrixXf& centroids();
+    
     double dissimilarity(Eigen::VectorXf evcPoint, unsigned int unCluster);
     std::vector<std::vector<double>> silhouettes();
     double silhouetteAverage(unsigned int unClusters);
     
+    // Criteria on the current clusters. Higher is better for
+    // Calinski-Harabasz, lower for Davies-Bouldin (here with RMS
+    // cluster spreads, q = 2) and BIC (one maximum likelihood Gaussian
+    // per cluster, weighted by cluster size).
+    double calinskiHarabasz();
+    double daviesBouldin();
+    double bic();
+    
     template<class ... Args>
       static KMeans::Ptr create(Args ... args) {
       return std::make_shared<KMeans>(std::forward<Args>(args)...);
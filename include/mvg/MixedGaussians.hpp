@@ -4,90 +4,485 @@
 
 #include <memory>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 #include <mvg/MultiVarGauss.hpp>
+#include <mvg/Parallel.h>
+#include <mvg/Random.h>
 
 
 namespace mvg {
-  template<typename T>
+  template<typename T, int Dim = Eigen::Dynamic>
   class MixedGaussians {
   public:
     typedef std::shared_ptr<MixedGaussians> Ptr;
     
     typedef struct {
-      typename MultiVarGauss<T>::Ptr mvgGaussian;
+      typename MultiVarGauss<T, Dim>::Ptr mvgGaussian;
       double dWeight;
-      typename MultiVarGauss<T>::DensityFunction fncDensity;
     } Gaussian;
     
+    // All valid components with a positive weight, packed for
+    // evaluation. Row block k of `mxWhitening` is L_k^-1 (L_k being the
+    // Cholesky factor of the k-th covariance), so the Mahalanobis
+    // terms of all components are the squared norms of the d-blocks of
+    // `mxWhitening * x - vxOffsets`, one matrix product for a batch of
+    // points. Weights are normalized to sum up to one.
+    typedef struct {
+      unsigned int unDimension;
+      unsigned int unComponents;
+      Eigen::MatrixXf mxWhitening; // (K d) x d
+      Eigen::VectorXf vxOffsets; // L_k^-1 mu_k, stacked
+      Eigen::ArrayXf arrLogConstants; // log(w_k) + log normalization
+    } Compiled;
+  
   private:
     std::vector<Gaussian> m_vecGaussians;
+    std::vector<double> m_vecLogLikelihoods;
+    Compiled m_cmpCompiled;
+    
+    static void extend(typename MultiVarGauss<T, Dim>::Rect& rctBB, const typename MultiVarGauss<T, Dim>::Rect& rctOther) {
+      if(rctBB.vecMin.size() == 0) {
+	rctBB = rctOther;
+      } else {
+	for(unsigned int unI = 0; unI < rctOther.vecMin.size() && unI < rctBB.vecMin.size(); ++unI) {
+	  rctBB.vecMin[unI] = std::min(rctBB.vecMin[unI], rctOther.vecMin[unI]);
+	  rctBB.vecMax[unI] = std::max(rctBB.vecMax[unI], rctOther.vecMax[unI]);
+	}
+      }
+    }
+    
+    static void pad(typename MultiVarGauss<T, Dim>::Rect& rctBB, double dPadding) {
+      for(unsigned int unI = 0; unI < rctBB.vecMin.size(); ++unI) {
+	rctBB.vecMin[unI] -= dPadding;
+	rctBB.vecMax[unI] += dPadding;
+      }
+    }
+    
+    static void logDensitiesCompiled(const Compiled& cmpMixture, const float* pfPoints, unsigned int unCount, unsigned int unStride, float* pfLogDensities) {
+      // Blocks of points: one matrix product for all Mahalanobis terms,
+      // then log-sum-exp over the components of every point.
+      const unsigned int unBlockSize = 256;
+      unsigned int unDimension = cmpMixture.unDimension;
+      unsigned int unComponents = cmpMixture.unComponents;
+      
+      if(unComponents == 0) {
+	std::fill(pfLogDensities, pfLogDensities + unCount, -std::numeric_limits<float>::infinity());
+	return;
+      }
+      
+      Eigen::Map<const Eigen::MatrixXf, 0, Eigen::OuterStride<>> mxPoints(pfPoints, unDimension, unCount, Eigen::OuterStride<>(unStride));
+      Eigen::MatrixXf mxWhitened;
+      Eigen::ArrayXXf arrTerms;
+      
+      for(unsigned int unStart = 0; unStart < unCount; unStart += unBlockSize) {
+	unsigned int unBlock = std::min(unBlockSize, unCount - unStart);
+	
+	mxWhitened.noalias() = cmpMixture.mxWhitening * mxPoints.middleCols(unStart, unBlock);
+	mxWhitened.colwise() -= cmpMixture.vxOffsets;
+	
+	// Column b of `mxWhitened` holds the K whitened differences of
+	// point b one after the other
+	arrTerms = Eigen::Map<Eigen::ArrayXXf>(mxWhitened.data(), unDimension, unComponents * unBlock).square().colwise().sum();
+	Eigen::Map<Eigen::ArrayXXf> arrComponentTerms(arrTerms.data(), unComponents, unBlock);
+	arrComponentTerms = (-0.5f * arrComponentTerms).colwise() + cmpMixture.arrLogConstants;
+	
+	Eigen::Array<float, 1, Eigen::Dynamic> arrMax = arrComponentTerms.colwise().maxCoeff();
+	Eigen::Map<Eigen::Array<float, 1, Eigen::Dynamic>>(pfLogDensities + unStart, unBlock) =
+	  arrMax + (arrComponentTerms.rowwise() - arrMax).exp().colwise().sum().log();
+      }
+    }
     
   protected:
   public:
-    MixedGaussians() {};
+    MixedGaussians() {
+      m_cmpCompiled = this->compile();
+    };
     ~MixedGaussians() {};
 
-    void addGaussian(typename MultiVarGauss<T>::Ptr mvgGaussian, double dWeight) {
-      m_vecGaussians.push_back({mvgGaussian, dWeight, mvgGaussian->densityFunction()});
+    void addGaussian(typename MultiVarGauss<T, Dim>::Ptr mvgGaussian, double dWeight) {
+      m_vecGaussians.push_back({mvgGaussian, dWeight});
+      m_cmpCompiled = this->compile();
     }
     
-    T sample(std::vector<T> vecValues) {
+    Compiled compile() {
+      Compiled cmpMixture;
       double dWeightSum = 0.0;
+      std::vector<typename MultiVarGauss<T, Dim>::Model> vecModels;
+      std::vector<double> vecWeights;
+      
       for(Gaussian& gsGaussian : m_vecGaussians) {
-	dWeightSum += gsGaussian.dWeight;
+	typename MultiVarGauss<T, Dim>::Model& mdlModel = gsGaussian.mvgGaussian->model();
+	
+	if(gsGaussian.dWeight > 0 && mdlModel.bValid) {
+	  vecModels.push_back(mdlModel);
+	  vecWeights.push_back(gsGaussian.dWeight);
+	  dWeightSum += gsGaussian.dWeight;
+	}
       }
       
-      T tSample = T();
+      unsigned int unDimension = (vecModels.size() > 0 ? vecModels[0].vxMean.size() : 0);
       
-      for(Gaussian& gsGaussian : m_vecGaussians) {
-	tSample += gsGaussian.dWeight * gsGaussian.fncDensity(vecValues);
+      cmpMixture.unDimension = unDimension;
+      cmpMixture.unComponents = vecModels.size();
+      cmpMixture.mxWhitening.resize(vecModels.size() * unDimension, unDimension);
+      cmpMixture.vxOffsets.resize(vecModels.size() * unDimension);
+      cmpMixture.arrLogConstants.resize(vecModels.size());
+      
+      for(unsigned int unComponent = 0; unComponent < vecModels.size(); ++unComponent) {
+	Eigen::MatrixXf mxCholesky = vecModels[unComponent].mxCholesky;
+	Eigen::MatrixXf mxWhitening = mxCholesky.triangularView<Eigen::Lower>().solve(Eigen::MatrixXf::Identity(unDimension, unDimension));
+	
+	cmpMixture.mxWhitening.middleRows(unComponent * unDimension, unDimension) = mxWhitening;
+	cmpMixture.vxOffsets.segment(unComponent * unDimension, unDimension) = mxWhitening * Eigen::VectorXf(vecModels[unComponent].vxMean);
+	cmpMixture.arrLogConstants[unComponent] = log(vecWeights[unComponent] / dWeightSum) + vecModels[unComponent].fLogNormalization;
       }
-
-      return tSample;
+      
+      return cmpMixture;
     }
     
-    void recalculateDensityFunctions() {
-      // The `MultiVarGauss::densityFunction()` function does some
-      // computation based on the data inside the MultiVarGauss
-      // instance. That's why we're getting the function object
-      // instead of calling `densityFunction()` each time we want to
-      // sample from the distribution.
-      for(Gaussian& gsGaussian : m_vecGaussians) {
-	gsGaussian.fncDensity = gsGaussian.mvgGaussian->densityFunction();
+    std::vector<Gaussian>& gaussians() {
+      return m_vecGaussians;
+    }
+    
+    bool fit(std::vector<Dataset::Ptr> vecClusters, unsigned int unMaxIterations = 100, double dTolerance = 1e-4) {
+      // Replaces the components by one per (non-empty) cluster, fitted
+      // to it and weighted by its share of the samples, and refines
+      // them by EM on the samples of all clusters together. Each
+      // component keeps its cluster as dataset (e.g. for the bounding
+      // box).
+      const double dRegularization = 1e-6;
+      Dataset::Ptr dsData;
+      unsigned long ulSamples = 0;
+      
+      for(Dataset::Ptr dsCluster : vecClusters) {
+	ulSamples += dsCluster->count();
       }
+      
+      m_vecGaussians.clear();
+      m_vecLogLikelihoods.clear();
+      
+      for(Dataset::Ptr dsCluster : vecClusters) {
+	if(dsCluster->count() > 0) {
+	  if(!dsData) {
+	    dsData = Dataset::create(dsCluster->dimension());
+	    dsData->reserve(ulSamples);
+	  }
+	  
+	  dsData->append(dsCluster->data(), dsCluster->count());
+	  
+	  typename MultiVarGauss<T, Dim>::Ptr mvgGaussian = MultiVarGauss<T, Dim>::create();
+	  mvgGaussian->setDataset(dsCluster);
+	  
+	  Statistics& stCluster = mvgGaussian->statistics();
+	  Eigen::MatrixXd mxCovariance = stCluster.covariance();
+	  mxCovariance.diagonal().array() += dRegularization;
+	  mvgGaussian->setParameters(stCluster.mean(), mxCovariance);
+	  
+	  this->addGaussian(mvgGaussian, (double)dsCluster->count() / ulSamples);
+	}
+      }
+      
+      if(!dsData) {
+	return false;
+      }
+      
+      return this->refine(dsData, unMaxIterations, dTolerance);
     }
     
-    typename MultiVarGauss<T>::Rect boundingBox() {
-      typename MultiVarGauss<T>::Rect rctBB;
+    bool refine(Dataset::Ptr dsData, unsigned int unMaxIterations = 100, double dTolerance = 1e-4) {
+      // Expectation maximization from the current components: the
+      // E-step evaluates all components on blocks of samples in
+      // parallel and turns them into responsibilities by log-sum-exp,
+      // collecting per-block weighted sums and scatters (relative to
+      // the current means, for numerical stability) that are reduced in
+      // block order. Stops once the mean log-likelihood per sample
+      // improves by less than `dTolerance`. The log-likelihood of every
+      // iteration is kept in `logLikelihoods()`.
+      const unsigned int unBlockSize = 1024;
+      const double dRegularization = 1e-6;
       
-      if(m_vecGaussians.size() > 0) {
-	rctBB = m_vecGaussians[0].mvgGaussian->boundingBox();
-	
+      typedef struct {
+	double dLogLikelihood;
+	Eigen::VectorXd vxCounts;
+	Eigen::MatrixXd mxSums;
+	std::vector<Eigen::MatrixXd> vecScatters;
+      } BlockStatistics;
+      
+      unsigned int unSamples = dsData->count();
+      unsigned int unDimension = dsData->dimension();
+      unsigned int unComponents = m_vecGaussians.size();
+      
+      m_vecLogLikelihoods.clear();
+      
+      if(unSamples == 0 || unComponents == 0) {
+	return false;
+      }
+      
+      Dataset::MatrixMap mxData = dsData->matrix();
+      std::vector<BlockStatistics> vecBlocks(Parallel::chunks(unSamples, unBlockSize));
+      
+      for(unsigned int unIteration = 0; unIteration < unMaxIterations; ++unIteration) {
+	// Fit (or reuse) every model up front, so that the parallel
+	// density evaluations below only read them
+	std::vector<Eigen::VectorXf> vecShifts;
 	for(Gaussian& gsGaussian : m_vecGaussians) {
-	  typename MultiVarGauss<T>::Rect rctCurrent = gsGaussian.mvgGaussian->boundingBox();
-	  
-	  for(unsigned int unI = 0; unI < rctCurrent.vecMin.size(); ++unI) {
-	    if(rctCurrent.vecMin[unI] < rctBB.vecMin[unI]) {
-	      rctBB.vecMin[unI] = rctCurrent.vecMin[unI];
+	  vecShifts.push_back(gsGaussian.mvgGaussian->model().vxMean);
+	}
+	
+	Parallel::forRange(unSamples, unBlockSize, [&](unsigned int unBegin, unsigned int unEnd) {
+	    BlockStatistics& bsBlock = vecBlocks[unBegin / unBlockSize];
+	    unsigned int unBlock = unEnd - unBegin;
+	    Eigen::ArrayXXf arrTerms(unBlock, unComponents);
+	    
+	    for(unsigned int unComponent = 0; unComponent < unComponents; ++unComponent) {
+	      Gaussian& gsGaussian = m_vecGaussians[unComponent];
+	      
+	      if(gsGaussian.dWeight > 0) {
+		gsGaussian.mvgGaussian->logDensities(mxData.col(unBegin).data(), unBlock, unDimension, arrTerms.col(unComponent).data());
+		arrTerms.col(unComponent) += (float)log(gsGaussian.dWeight);
+	      } else {
+		arrTerms.col(unComponent).setConstant(-std::numeric_limits<float>::infinity());
+	      }
 	    }
 	    
-	    if(rctCurrent.vecMax[unI] > rctBB.vecMax[unI]) {
-	      rctBB.vecMax[unI] = rctCurrent.vecMax[unI];
+	    Eigen::ArrayXf arrMax = arrTerms.rowwise().maxCoeff();
+	    arrMax = arrMax.isFinite().select(arrMax, 0.0f);
+	    Eigen::ArrayXf arrLogSums = arrMax + (arrTerms.colwise() - arrMax).exp().rowwise().sum().log();
+	    
+	    // Samples no component explains get no responsibilities
+	    Eigen::ArrayXXf arrResponsibilities = (arrTerms.colwise() - arrLogSums).exp();
+	    arrResponsibilities = arrResponsibilities.isFinite().select(arrResponsibilities, 0.0f);
+	    
+	    bsBlock.dLogLikelihood = arrLogSums.template cast<double>().sum();
+	    bsBlock.vxCounts = arrResponsibilities.colwise().sum().template cast<double>().transpose();
+	    bsBlock.mxSums.resize(unDimension, unComponents);
+	    bsBlock.vecScatters.resize(unComponents);
+	    
+	    for(unsigned int unComponent = 0; unComponent < unComponents; ++unComponent) {
+	      Eigen::MatrixXd mxCentered = (mxData.middleCols(unBegin, unBlock).colwise() - vecShifts[unComponent]).template cast<double>();
+	      Eigen::MatrixXd mxWeighted = mxCentered.array().rowwise() * arrResponsibilities.col(unComponent).transpose().template cast<double>();
+	      
+	      bsBlock.mxSums.col(unComponent) = mxWeighted.rowwise().sum();
+	      bsBlock.vecScatters[unComponent].noalias() = mxWeighted * mxCentered.transpose();
 	    }
+	  });
+	
+	double dLogLikelihood = 0.0;
+	Eigen::VectorXd vxCounts = Eigen::VectorXd::Zero(unComponents);
+	Eigen::MatrixXd mxSums = Eigen::MatrixXd::Zero(unDimension, unComponents);
+	std::vector<Eigen::MatrixXd> vecScatters(unComponents, Eigen::MatrixXd::Zero(unDimension, unDimension));
+	
+	for(BlockStatistics& bsBlock : vecBlocks) {
+	  dLogLikelihood += bsBlock.dLogLikelihood;
+	  vxCounts += bsBlock.vxCounts;
+	  mxSums += bsBlock.mxSums;
+	  
+	  for(unsigned int unComponent = 0; unComponent < unComponents; ++unComponent) {
+	    vecScatters[unComponent] += bsBlock.vecScatters[unComponent];
+	  }
+	}
+	
+	m_vecLogLikelihoods.push_back(dLogLikelihood / unSamples);
+	
+	if(!std::isfinite(m_vecLogLikelihoods.back())) {
+	  std::cerr << "EM: log-likelihood is not finite, giving up." << std::endl;
+	  
+	  // Keep the densities in line with the components the last
+	  // M-step left behind
+	  this->recalculateDensityFunctions();
+	  
+	  return false;
+	}
+	
+	if(unIteration > 0 && std::abs(m_vecLogLikelihoods.back() - m_vecLogLikelihoods[unIteration - 1]) < dTolerance) {
+	  break;
+	}
+	
+	// M-step
+	for(unsigned int unComponent = 0; unComponent < unComponents; ++unComponent) {
+	  Gaussian& gsGaussian = m_vecGaussians[unComponent];
+	  double dCount = vxCounts[unComponent];
+	  
+	  if(dCount < 10 * std::numeric_limits<float>::epsilon()) {
+	    // Lost all its samples
+	    gsGaussian.dWeight = 0.0;
+	    continue;
 	  }
+	  
+	  Eigen::VectorXd vxShift = mxSums.col(unComponent) / dCount;
+	  Eigen::MatrixXd mxCovariance = vecScatters[unComponent] / dCount - vxShift * vxShift.transpose();
+	  mxCovariance.diagonal().array() += dRegularization;
+	  
+	  gsGaussian.dWeight = dCount / unSamples;
+	  gsGaussian.mvgGaussian->setParameters(vecShifts[unComponent].template cast<double>() + vxShift, mxCovariance);
 	}
+      }
+      
+      this->recalculateDensityFunctions();
+      
+      return true;
+    }
+    
+    std::vector<double>& logLikelihoods() {
+      return m_vecLogLikelihoods;
+    }
+    
+    T sample(std::vector<T> vecValues) {
+      return exp(this->logSample(vecValues));
+    }
+    
+    T logSample(std::vector<T> vecValues) {
+      // log(sum_k w_k N_k(x)) by log-sum-exp on the compiled mixture
+      // (as of the last `addGaussian()` or
+      // `recalculateDensityFunctions()`), so that points far away from
+      // all components don't underflow to log(0).
+      Eigen::VectorXf vxPoint(vecValues.size());
+      float fLogDensity;
+      
+      if(vecValues.size() != m_cmpCompiled.unDimension) {
+	return -std::numeric_limits<T>::infinity();
+      }
+      
+      for(unsigned int unI = 0; unI < vecValues.size(); ++unI) {
+	vxPoint[unI] = vecValues[unI];
+      }
+      
+      MixedGaussians::logDensitiesCompiled(m_cmpCompiled, vxPoint.data(), 1, vxPoint.size(), &fLogDensity);
+      
+      return fLogDensity;
+    }
+    
+    void densities(const float* pfPoints, unsigned int unCount, unsigned int unStride, float* pfDensities) {
+      // Batch version of `sample()`; see `MultiVarGauss::densities()`
+      // for the point layout.
+      this->logDensities(pfPoints, unCount, unStride, pfDensities);
+      
+      Eigen::Map<Eigen::ArrayXf> arrDensities(pfDensities, unCount);
+      arrDensities = arrDensities.exp();
+    }
+    
+    void densities(const Eigen::Ref<const Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>& mxPoints, float* pfDensities) {
+      this->densities(mxPoints.data(), mxPoints.rows(), mxPoints.outerStride(), pfDensities);
+    }
+    
+    void logDensities(const float* pfPoints, unsigned int unCount, unsigned int unStride, float* pfLogDensities) {
+      // Batch version of `logSample()`, on the same compiled mixture.
+      MixedGaussians::logDensitiesCompiled(m_cmpCompiled, pfPoints, unCount, unStride, pfLogDensities);
+    }
+    
+    void logDensities(const Eigen::Ref<const Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>& mxPoints, float* pfLogDensities) {
+      this->logDensities(mxPoints.data(), mxPoints.rows(), mxPoints.outerStride(), pfLogDensities);
+    }
+    
+    bool draw(float* pfSamples, unsigned int unCount, uint64_t ulSeed) {
+      // Writes `unCount` samples like `MultiVarGauss::draw()`; the
+      // component of every sample is picked from an alias table over
+      // the (normalized) weights of the valid components. Within a
+      // chunk, samples are grouped by component so that each component
+      // transforms its normals in one product, and are scattered back
+      // to their positions afterwards. False if no component is valid.
+      const unsigned int unGrain = 4096;
+      std::vector<typename MultiVarGauss<T, Dim>::Model> vecModels;
+      std::vector<double> vecWeights;
+      
+      for(Gaussian& gsGaussian : m_vecGaussians) {
+	typename MultiVarGauss<T, Dim>::Model& mdlModel = gsGaussian.mvgGaussian->model();
 	
-	rctBB.vecMin[0] -= 1;
-	rctBB.vecMin[1] -= 1;
-	rctBB.vecMax[0] += 1;
-	rctBB.vecMax[1] += 1;
+	if(gsGaussian.dWeight > 0 && mdlModel.bValid) {
+	  vecModels.push_back(mdlModel);
+	  vecWeights.push_back(gsGaussian.dWeight);
+	}
       }
       
+      if(vecModels.size() == 0) {
+	return false;
+      }
+      
+      unsigned int unSize = vecModels[0].vxMean.size();
+      AliasTable atComponents(vecWeights);
+      
+      Parallel::forRange(unCount, unGrain, [&](unsigned int unBegin, unsigned int unEnd) {
+	  Random rndRandom(ulSeed, unBegin / unGrain);
+	  unsigned int unChunk = unEnd - unBegin;
+	  std::vector<unsigned int> vecComponents(unChunk);
+	  std::vector<unsigned int> vecOffsets(vecModels.size() + 1, 0);
+	  std::vector<unsigned int> vecOrder(unChunk);
+	  Eigen::Matrix<float, Dim, Eigen::Dynamic> mxGrouped(unSize, unChunk);
+	  Eigen::Map<Eigen::Matrix<float, Dim, Eigen::Dynamic>> mxSamples(pfSamples + (size_t)unBegin * unSize, unSize, unChunk);
+	  
+	  for(unsigned int unI = 0; unI < unChunk; ++unI) {
+	    vecComponents[unI] = atComponents.draw(rndRandom);
+	    vecOffsets[vecComponents[unI] + 1]++;
+	  }
+	  
+	  for(unsigned int unComponent = 0; unComponent < vecModels.size(); ++unComponent) {
+	    vecOffsets[unComponent + 1] += vecOffsets[unComponent];
+	  }
+	  
+	  std::vector<unsigned int> vecNext(vecOffsets.begin(), vecOffsets.end() - 1);
+	  for(unsigned int unI = 0; unI < unChunk; ++unI) {
+	    vecOrder[vecNext[vecComponents[unI]]++] = unI;
+	  }
+	  
+	  for(unsigned int unComponent = 0; unComponent < vecModels.size(); ++unComponent) {
+	    unsigned int unGroup = vecOffsets[unComponent + 1] - vecOffsets[unComponent];
+	    
+	    if(unGroup > 0) {
+	      MultiVarGauss<T, Dim>::drawFromModel(vecModels[unComponent], mxGrouped.col(vecOffsets[unComponent]).data(), unGroup, rndRandom);
+	    }
+	  }
+	  
+	  for(unsigned int unI = 0; unI < unChunk; ++unI) {
+	    mxSamples.col(vecOrder[unI]) = mxGrouped.col(unI);
+	  }
+	});
+      
+      return true;
+    }
+    
+    void recalculateDensityFunctions() {
+      // Recompiles the mixture that all density evaluations use; call
+      // it after changing the components' data, parameters or weights.
+      // `MultiVarGauss::model()` only refits a component if its data
+      // changed since the last call.
+      m_cmpCompiled = this->compile();
+    }
+    
+    typename MultiVarGauss<T, Dim>::Rect boundingBox(double dPadding = 1.0) {
+      // Extent of all components' data, padded by `dPadding` in every
+      // dimension.
+      typename MultiVarGauss<T, Dim>::Rect rctBB;
+      
+      for(Gaussian& gsGaussian : m_vecGaussians) {
+	MixedGaussians::extend(rctBB, gsGaussian.mvgGaussian->boundingBox());
+      }
+      
+      MixedGaussians::pad(rctBB, dPadding);
+      
+      return rctBB;
+    }
+    
+    typename MultiVarGauss<T, Dim>::Rect sigmaBox(double dSigmas, double dPadding = 0.0) {
+      // Union of the `MultiVarGauss::sigmaBox()`es of all components
+      // that take part in the density (valid, positive weight).
+      typename MultiVarGauss<T, Dim>::Rect rctBB;
+      
+      for(Gaussian& gsGaussian : m_vecGaussians) {
+	if(gsGaussian.dWeight > 0) {
+	  MixedGaussians::extend(rctBB, gsGaussian.mvgGaussian->sigmaBox(dSigmas));
+	}
+      }
+      
+      MixedGaussians::pad(rctBB, dPadding);
+      
       return rctBB;
     }
     
-    typename MultiVarGauss<T>::DensityFunction densityFunction() {
+    typename MultiVarGauss<T, Dim>::DensityFunction densityFunction() {
       this->recalculateDensityFunctions();
       
       return [this](std::vector<T> vecValues) -> T {
@@ -95,15 +490,23 @@ namespace mvg {
       };
     }
     
+    typename MultiVarGauss<T, Dim>::DensityFunction logDensityFunction() {
+      this->recalculateDensityFunctions();
+      
+      return [this](std::vector<T> vecValues) -> T {
+	return this->logSample(vecValues);
+      };
+    }
+    
     template<class ... Args>
-    static MixedGaussians<T>::Ptr create(Args ... args) {
-      return std::make_shared<MixedGaussians<T>>(std::forward<Args>(args)...);
+    static MixedGaussians<T, Dim>::Ptr create(Args ... args) {
+      return std::make_shared<MixedGaussians<T, Dim>>(std::forward<Args>(args)...);
     }
   };
 
   class MixedGaussiansDriver{
     public:    
-      static int runMainMethod();
+      static int runMainMethod(RasterFile::Format fmtFormat = RasterFile::CSV);
       static int runJNIMethod(char* fileName);
     private:
       static mvg::MixedGaussians<float> createMixedGaussians();
@@ -5,32 +5,180 @@
 #include <memory>
 #include <iostream>
 #include <functional>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 #include <Eigen/LU>
 #include <Eigen/Dense>
 #include <unsupported/Eigen/src/MatrixFunctions/MatrixExponential.h>
 
 #include <mvg/Dataset.hpp>
+#include <mvg/Statistics.hpp>
+#include <mvg/RasterFile.h>
+#include <mvg/Random.h>
+#include <mvg/Parallel.h>
 
 
 namespace mvg {
-  template<typename T>
+  // `Dim` fixes the data dimension at compile time, so the model is
+  // kept in fixed-size Eigen types. With the default
+  // (`Eigen::Dynamic`) the dimension is taken from the data, and
+  // density evaluation is still dispatched to fixed-size kernels for
+  // two, three and four dimensions.
+  template<typename T, int Dim = Eigen::Dynamic>
   class MultiVarGauss {
   public:
     typedef std::shared_ptr<MultiVarGauss> Ptr;
     typedef std::function<float(std::vector<T>)> DensityFunction;
+    // Unaligned, so that models (and everything holding one) can live
+    // in `std::make_shared()` and plain `std::vector`s whatever static
+    // alignment the vectorization asks for.
+    typedef Eigen::Matrix<float, Dim, 1, Eigen::ColMajor | Eigen::DontAlign> Vector;
+    typedef Eigen::Matrix<float, Dim, Dim, Eigen::ColMajor | Eigen::DontAlign> Matrix;
     
     typedef struct {
       std::vector<T> vecMin;
       std::vector<T> vecMax;
     } Rect;
     
+    // Everything density evaluation needs, derived from the data once
+    // and reused until the data changes. The covariance is kept as its
+    // Cholesky factor `mxCholesky` (lower triangular, Sigma = L * L^T).
+    typedef struct {
+      Vector vxMean;
+      Matrix mxCholesky;
+      float fLogDeterminant;
+      float fLogNormalization; // log(1 / sqrt((2 pi)^n * det(Sigma)))
+      bool bValid; // False if the covariance isn't positive definite
+    } Model;
+  
   private:
     typename Dataset::Ptr m_dsData;
+    Statistics m_stStatistics;
+    unsigned int m_unAccumulated;
+    Model m_mdlModel;
+    bool m_bDirty;
+    
+    void accumulate() {
+      // Folds samples added to the dataset since the last call into
+      // the running statistics. Rows already accounted for are never
+      // visited again.
+      if(m_dsData) {
+	const unsigned int unBlockSize = 4096;
+	unsigned int unCount = m_dsData->count();
+	
+	if(Dim != Eigen::Dynamic && unCount > 0 && m_dsData->dimension() != (unsigned int)Dim) {
+	  std::cerr << "Dataset dimension " << m_dsData->dimension() << " doesn't match the Gaussian's dimension " << Dim << std::endl;
+	  return;
+	}
+	
+	Eigen::Map<Eigen::Matrix<float, Dim, Eigen::Dynamic>> mxData = m_dsData->template fixedMatrix<Dim>();
+	
+	while(m_unAccumulated < unCount) {
+	  unsigned int unBlock = std::min(unBlockSize, unCount - m_unAccumulated);
+	  
+	  m_stStatistics.addBlock(mxData.middleCols(m_unAccumulated, unBlock));
+	  m_unAccumulated += unBlock;
+	  m_bDirty = true;
+	}
+      }
+    }
+    
+    void setModel(const Eigen::VectorXd& vxMean, const Eigen::MatrixXd& mxCovariance) {
+      unsigned int unSize = vxMean.size();
+      
+      m_mdlModel.bValid = false;
+      
+      if(unSize > 0 && (Dim == Eigen::Dynamic || unSize == (unsigned int)Dim)) {
+	m_mdlModel.vxMean = vxMean.template cast<float>();
+	
+	Eigen::LLT<Eigen::MatrixXd> lltCov(mxCovariance);
+	
+	if(lltCov.info() == Eigen::Success) {
+	  Eigen::MatrixXd mxL = lltCov.matrixL();
+	  double dLogDeterminant = 2.0 * mxL.diagonal().array().log().sum();
+	  
+	  m_mdlModel.mxCholesky = mxL.template cast<float>();
+	  m_mdlModel.fLogDeterminant = dLogDeterminant;
+	  m_mdlModel.fLogNormalization = -0.5 * (unSize * log(2 * M_PI) + dLogDeterminant);
+	  m_mdlModel.bValid = std::isfinite(dLogDeterminant);
+	}
+      }
+      
+      m_bDirty = false;
+    }
+    
+    void fit() {
+      if(m_stStatistics.count() > 0 && m_stStatistics.dimension() > 0) {
+	this->setModel(m_stStatistics.mean(), m_stStatistics.covariance());
+      } else {
+	m_mdlModel.bValid = false;
+	m_bDirty = false;
+      }
+    }
+    
+    template<int N>
+      static float logDensityFixed(const Model& mdlModel, const std::vector<T>& vecPoint) {
+      // Allocation free and unrolled for small dimensions; the model is
+      // mapped, so this works for dynamically sized models as well.
+      Eigen::Matrix<float, N, 1> vxDiff;
+      
+      for(unsigned int unI = 0; unI < (unsigned int)N; ++unI) {
+	vxDiff[unI] = vecPoint[unI] - mdlModel.vxMean[unI];
+      }
+      
+      Eigen::Map<const Eigen::Matrix<float, N, N>>(mdlModel.mxCholesky.data()).template triangularView<Eigen::Lower>().solveInPlace(vxDiff);
+      
+      return mdlModel.fLogNormalization - 0.5 * vxDiff.squaredNorm();
+    }
     
+    template<int N>
+      static void logDensitiesFixed(const Model& mdlModel, const float* pfPoints, unsigned int unCount, unsigned int unStride, float* pfLogDensities) {
+      Eigen::Map<const Eigen::Matrix<float, N, 1>> vxMean(mdlModel.vxMean.data());
+      Eigen::Matrix<float, N, N> mxCholesky = Eigen::Map<const Eigen::Matrix<float, N, N>>(mdlModel.mxCholesky.data());
+      
+      for(unsigned int unI = 0; unI < unCount; ++unI) {
+	Eigen::Matrix<float, N, 1> vxDiff = Eigen::Map<const Eigen::Matrix<float, N, 1>>(pfPoints + (size_t)unI * unStride) - vxMean;
+	mxCholesky.template triangularView<Eigen::Lower>().solveInPlace(vxDiff);
+	
+	pfLogDensities[unI] = mdlModel.fLogNormalization - 0.5 * vxDiff.squaredNorm();
+      }
+    }
+    
+    static float logDensity(const Model& mdlModel, const std::vector<T>& vecPoint) {
+      if(!mdlModel.bValid) {
+	return -std::numeric_limits<float>::infinity();
+      }
+      
+      if(vecPoint.size() == (size_t)mdlModel.vxMean.size()) {
+	switch(vecPoint.size()) {
+	case 2:
+	  return MultiVarGauss::logDensityFixed<2>(mdlModel, vecPoint);
+	
+	case 3:
+	  return MultiVarGauss::logDensityFixed<3>(mdlModel, vecPoint);
+	
+	case 4:
+	  return MultiVarGauss::logDensityFixed<4>(mdlModel, vecPoint);
+	}
+      }
+      
+      Vector vxDiff(vecPoint.size());
+      
+      for(unsigned int unI = 0; unI < vecPoint.size(); ++unI) {
+	vxDiff[unI] = vecPoint[unI] - mdlModel.vxMean[unI];
+      }
+      
+      // (x - mu)^T Sigma^-1 (x - mu) = |L^-1 (x - mu)|^2
+      mdlModel.mxCholesky.template triangularView<Eigen::Lower>().solveInPlace(vxDiff);
+      
+      return mdlModel.fLogNormalization - 0.5 * vxDiff.squaredNorm();
+    }
+  
   protected:
   public:
-    MultiVarGauss() : m_dsData(nullptr) {
+    MultiVarGauss() : m_dsData(nullptr), m_unAccumulated(0), m_bDirty(true) {
     }
     
     ~MultiVarGauss() {
@@ -44,30 +192,59 @@ namespace mvg {
       return 0;
     }
     
-    Eigen::VectorXf dataMean() {
-      unsigned int unSize = this->dataDimension();
-      Eigen::VectorXf vxMean = Eigen::VectorXf::Zero(unSize);
-      
-      for(unsigned int unI = 0; unI < m_dsData->count(); ++unI) {
-	vxMean += (*m_dsData)[unI];
-      }
+    Statistics& statistics() {
+      this->accumulate();
       
-      vxMean /= m_dsData->count();
-      return vxMean;
+      return m_stStatistics;
+    }
+    
+    Eigen::VectorXf dataMean() {
+      return this->statistics().mean().template cast<float>();
     }
     
     void setDataset(typename Dataset::Ptr dsData) {
       m_dsData = dsData;
+      m_stStatistics.clear();
+      m_unAccumulated = 0;
+      m_bDirty = true;
     }
     
-    static void addToDataset(mvg::Dataset::Ptr dsDataset, std::vector<float> vecData) {
-      Eigen::VectorXf vxdData(vecData.size());
+    void addSample(std::vector<T> vecSample) {
+      // Appends to the dataset (creating one if necessary); the
+      // statistics pick the new sample up on their next use.
+      if(!m_dsData) {
+	this->setDataset(Dataset::create());
+      }
       
-      for(unsigned int unI = 0; unI < vecData.size(); ++unI) {
-	vxdData[unI] = vecData[unI];
+      Eigen::VectorXf vxSample(vecSample.size());
+      for(unsigned int unI = 0; unI < vecSample.size(); ++unI) {
+	vxSample[unI] = vecSample[unI];
       }
       
-      dsDataset->add(vxdData);
+      m_dsData->add(vxSample);
+    }
+    
+    bool addSamples(const float* pfSamples, unsigned int unRows, unsigned int unDimension) {
+      if(!m_dsData) {
+	this->setDataset(Dataset::create(unDimension));
+      }
+      
+      if(unRows == 0) {
+	return true;
+      } else if(m_dsData->dimension() == 0) {
+	m_dsData->reserve(unRows);
+	m_dsData->add(Eigen::Map<const Eigen::VectorXf>(pfSamples, unDimension));
+	pfSamples += unDimension;
+	unRows--;
+      } else if(m_dsData->dimension() != unDimension) {
+	return false;
+      }
+      
+      return m_dsData->append(pfSamples, unRows);
+    }
+    
+    static void addToDataset(mvg::Dataset::Ptr dsDataset, std::vector<float> vecData) {
+      dsDataset->add(Eigen::Map<Eigen::VectorXf>(vecData.data(), vecData.size()));
     }
     
     void setDataset(std::vector<std::vector<T>> vecData) {
@@ -81,69 +258,172 @@ namespace mvg {
     }
     
     Eigen::MatrixXf covariance() {
-      unsigned int unSize = this->dataDimension();
+      return this->statistics().covariance().template cast<float>();
+    }
+    
+    bool setParameters(const Eigen::VectorXd& vxMean, const Eigen::MatrixXd& mxCovariance) {
+      // Uses the given mean and covariance (e.g. estimated by EM)
+      // instead of the ones of the dataset, until samples are added or
+      // the dataset is replaced. False if the covariance isn't positive
+      // definite.
+      this->accumulate();
+      this->setModel(vxMean, mxCovariance);
       
-      Eigen::MatrixXf mxCov = Eigen::MatrixXf::Zero(unSize, unSize);
-      Eigen::VectorXf vxMean = this->dataMean();
+      return m_mdlModel.bValid;
+    }
+    
+    Model& model() {
+      // Only refits if samples were added or the dataset was replaced
+      // since the last call.
+      this->accumulate();
       
-      for(unsigned int unI = 0; unI < m_dsData->count(); ++unI) {
-	Eigen::VectorXf vxDiff = ((*m_dsData)[unI] - vxMean).conjugate();
-	mxCov += vxDiff * vxDiff.adjoint();
+      if(m_bDirty) {
+	this->fit();
       }
       
-      mxCov /= m_dsData->count();
-      return mxCov;
+      return m_mdlModel;
     }
     
     DensityFunction densityFunction() {
-      Eigen::MatrixXf mxCov = this->covariance();
-      Eigen::MatrixXf mxCovInverse = mxCov.inverse();
+      Model mdlModel = this->model();
       
-      float fDet = mxCov.determinant();
-      unsigned int unSize = this->dataDimension();
+      return [mdlModel](std::vector<T> vecPoint) -> float {
+	return exp(MultiVarGauss::logDensity(mdlModel, vecPoint));
+      };
+    }
+    
+    DensityFunction logDensityFunction() {
+      // Natural logarithm of the density; stays finite far away from
+      // the mean where the density itself underflows to zero, and is
+      // -infinity if the model is invalid.
+      Model mdlModel = this->model();
       
-      float fTwoPiToTheN = pow(2 * M_PI, unSize);
-      float fTwoPiToTheNTimesDet = fTwoPiToTheN * fDet;
-      float fCoefficient = 1.0 / sqrt(fTwoPiToTheNTimesDet);
+      return [mdlModel](std::vector<T> vecPoint) -> float {
+	return MultiVarGauss::logDensity(mdlModel, vecPoint);
+      };
+    }
+    
+    void logDensities(const float* pfPoints, unsigned int unCount, unsigned int unStride, float* pfLogDensities) {
+      // Evaluates `unCount` points; point `i` starts at `pfPoints + i *
+      // unStride`. Points are processed in blocks so that all
+      // Mahalanobis terms of a block come from one triangular solve.
+      const unsigned int unBlockSize = 1024;
+      Model& mdlModel = this->model();
+      unsigned int unSize = mdlModel.vxMean.size();
       
-      Eigen::VectorXf vxMean = this->dataMean();
+      if(!mdlModel.bValid) {
+	std::fill(pfLogDensities, pfLogDensities + unCount, -std::numeric_limits<float>::infinity());
+	return;
+      }
       
-      return [mxCovInverse, fCoefficient, vxMean](std::vector<T> vecPoint) -> float {
-	Eigen::VectorXf vxX(vecPoint.size());
-	
-	for(unsigned int unI = 0; unI < vecPoint.size(); ++unI) {
-	  vxX[unI] = vecPoint[unI];
-	}
+      switch(unSize) {
+      case 2:
+	MultiVarGauss::logDensitiesFixed<2>(mdlModel, pfPoints, unCount, unStride, pfLogDensities);
+	return;
+      
+      case 3:
+	MultiVarGauss::logDensitiesFixed<3>(mdlModel, pfPoints, unCount, unStride, pfLogDensities);
+	return;
+      
+      case 4:
+	MultiVarGauss::logDensitiesFixed<4>(mdlModel, pfPoints, unCount, unStride, pfLogDensities);
+	return;
+      }
+      
+      Eigen::Map<const Eigen::Matrix<float, Dim, Eigen::Dynamic>, 0, Eigen::OuterStride<>> mxPoints(pfPoints, unSize, unCount, Eigen::OuterStride<>(unStride));
+      Eigen::Matrix<float, Dim, Eigen::Dynamic> mxDiff;
+      
+      for(unsigned int unStart = 0; unStart < unCount; unStart += unBlockSize) {
+	unsigned int unBlock = std::min(unBlockSize, unCount - unStart);
 	
-	Eigen::VectorXf vxDiff = vxX - vxMean;
-	float fExp = exp(vxDiff.transpose() * (mxCovInverse / -2) * vxDiff);
+	mxDiff = mxPoints.middleCols(unStart, unBlock).colwise() - mdlModel.vxMean;
+	mdlModel.mxCholesky.template triangularView<Eigen::Lower>().solveInPlace(mxDiff);
 	
-	return fCoefficient * fExp;
-      };
+	Eigen::Map<Eigen::ArrayXf>(pfLogDensities + unStart, unBlock) =
+	  mdlModel.fLogNormalization - 0.5 * mxDiff.colwise().squaredNorm().transpose().array();
+      }
+    }
+    
+    void logDensities(const Eigen::Ref<const Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>& mxPoints, float* pfLogDensities) {
+      this->logDensities(mxPoints.data(), mxPoints.rows(), mxPoints.outerStride(), pfLogDensities);
+    }
+    
+    void densities(const float* pfPoints, unsigned int unCount, unsigned int unStride, float* pfDensities) {
+      this->logDensities(pfPoints, unCount, unStride, pfDensities);
+      
+      Eigen::Map<Eigen::ArrayXf> arrDensities(pfDensities, unCount);
+      arrDensities = arrDensities.exp();
+    }
+    
+    void densities(const Eigen::Ref<const Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>& mxPoints, float* pfDensities) {
+      // One point per row.
+      this->densities(mxPoints.data(), mxPoints.rows(), mxPoints.outerStride(), pfDensities);
+    }
+    
+    static void drawFromModel(const Model& mdlModel, float* pfSamples, unsigned int unCount, Random& rndRandom) {
+      // x = mu + L z for standard normal z, all `unCount` samples of a
+      // call in one matrix product; one sample after the other.
+      unsigned int unSize = mdlModel.vxMean.size();
+      Eigen::Map<Eigen::Matrix<float, Dim, Eigen::Dynamic>> mxSamples(pfSamples, unSize, unCount);
+      
+      rndRandom.normals(pfSamples, unSize * unCount);
+      mxSamples = mdlModel.mxCholesky.template triangularView<Eigen::Lower>() * mxSamples;
+      mxSamples.colwise() += mdlModel.vxMean;
+    }
+    
+    bool draw(float* pfSamples, unsigned int unCount, uint64_t ulSeed) {
+      // Writes `unCount` samples, one after the other, from the current
+      // model. Chunks of the output are
+      // generated in parallel, each from its own random stream, so the
+      // result only depends on the seed. False if the model is invalid.
+      const unsigned int unGrain = 4096;
+      Model& mdlModel = this->model();
+      unsigned int unSize = mdlModel.vxMean.size();
+      
+      if(!mdlModel.bValid) {
+	return false;
+      }
+      
+      Parallel::forRange(unCount, unGrain, [&](unsigned int unBegin, unsigned int unEnd) {
+	  Random rndRandom(ulSeed, unBegin / unGrain);
+	  
+	  MultiVarGauss::drawFromModel(mdlModel, pfSamples + (size_t)unBegin * unSize, unEnd - unBegin, rndRandom);
+	});
+      
+      return true;
     }
     
     Rect boundingBox() {
+      // Extent of the data, kept up to date by the running statistics
+      // rather than scanning the dataset.
       Rect rctBB;
+      Statistics& stStatistics = this->statistics();
       
-      if(m_dsData && m_dsData->count() > 0) {
-	unsigned int unSize = this->dataDimension();
+      if(stStatistics.count() > 0) {
+	Eigen::VectorXd vxMin = stStatistics.minimum();
+	Eigen::VectorXd vxMax = stStatistics.maximum();
 	
-	rctBB.vecMin.resize(unSize);
-	rctBB.vecMax.resize(unSize);
-	
-	for(unsigned int unI = 0; unI < unSize; ++unI) {
-	  rctBB.vecMin[unI] = (*m_dsData)[0][unI];
-	  rctBB.vecMax[unI] = (*m_dsData)[0][unI];
-	}
+	rctBB.vecMin.assign(vxMin.data(), vxMin.data() + vxMin.size());
+	rctBB.vecMax.assign(vxMax.data(), vxMax.data() + vxMax.size());
+      }
+      
+      return rctBB;
+    }
+    
+    Rect sigmaBox(double dSigmas) {
+      // Box around the points within Mahalanobis distance `dSigmas` of
+      // the model's mean, i.e. mean +- dSigmas * standard deviation in
+      // every dimension. Empty if the model is invalid.
+      Rect rctBB;
+      Model& mdlModel = this->model();
+      
+      if(mdlModel.bValid) {
+	Eigen::VectorXd vxMean = mdlModel.vxMean.template cast<double>();
+	Eigen::VectorXd vxRadius = dSigmas * mdlModel.mxCholesky.template cast<double>().rowwise().norm();
 	
-	for(unsigned int unD = 1; unD < m_dsData->count(); ++unD) {
-	  for(unsigned int unI = 0; unI < unSize; ++unI) {
-	    if((*m_dsData)[unD][unI] < rctBB.vecMin[unI]) {
-	      rctBB.vecMin[unI] = (*m_dsData)[unD][unI];
-	    } else if((*m_dsData)[unD][unI] > rctBB.vecMax[unI]) {
-	      rctBB.vecMax[unI] = (*m_dsData)[unD][unI];
-	    }
-	  }
+	for(unsigned int unI = 0; unI < vxMean.size(); ++unI) {
+	  rctBB.vecMin.push_back(vxMean[unI] - vxRadius[unI]);
+	  rctBB.vecMax.push_back(vxMean[unI] + vxRadius[unI]);
 	}
       }
       
@@ -158,12 +438,10 @@ namespace mvg {
 
   class MultiVarGaussDriver{
   public:    
-    int runMainMethod(char* inputName);
+    int runMainMethod(char* inputName, RasterFile::Format fmtFormat = RasterFile::CSV);
     int runJNIMethod(char* inputName, char* fileName);
   private:
     mvg::MultiVarGauss<float> createMultiVarGauss(char* inputName);
-    std::map<unsigned int, std::map<std::string, unsigned int>> mapNominalValues;
-    unsigned int nominalValue(unsigned int unRow, std::string strValue); 
   };  
 }
 
@@ -0,0 +1,42 @@
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+
+#include <memory>
+#include <iostream>
+#include <functional>
+
+
+namespace mvg {
+  // Fork/join helper for data parallel loops. The range [0, unCount)
+  // is cut into chunks of `unGrain` indices, which worker threads pick
+  // up one after the other until none are left; the calling thread
+  // takes part in the work. A chunk always starts at a multiple of
+  // `unGrain`, so `unBegin / unGrain` identifies it (e.g. to address
+  // per-chunk partial results that are reduced in order afterwards).
+  // A `forRange()` nested inside the body of another runs serially.
+  // Worker threads are started on first use and reused by later calls.
+  // If the body throws, no further chunks are started and the first
+  // exception is rethrown by `forRange()` once all threads are done.
+  class Parallel {
+  public:
+    typedef std::function<void(unsigned int unBegin, unsigned int unEnd)> RangeFunction;
+    
+  private:
+    static unsigned int s_unThreads;
+    static thread_local bool s_bInside;
+    
+  protected:
+  public:
+    // Number of threads used when none is given explicitly; defaults
+    // to the number of hardware threads.
+    static unsigned int threads();
+    static void setThreads(unsigned int unThreads);
+    
+    static unsigned int chunks(unsigned int unCount, unsigned int unGrain);
+    static void forRange(unsigned int unCount, unsigned int unGrain, RangeFunction fncBody, unsigned int unThreads = 0);
+  };
+}
+
+
+#endif /* __PARALLEL_H__ */
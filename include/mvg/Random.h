@@ -0,0 +1,67 @@
+#ifndef __RANDOM_H__
+#define __RANDOM_H__
+
+
+#include <memory>
+#include <iostream>
+#include <vector>
+#include <array>
+#include <cstdint>
+
+
+namespace mvg {
+  // Counter-based random numbers (Philox4x32-10, Salmon et al.): the
+  // n-th block of a stream is a pure function of (seed, stream, n), so
+  // independent streams need no shared state. Giving every chunk of a
+  // parallel loop its own stream (e.g. its chunk index) makes the
+  // result independent of the number of threads.
+  class Random {
+  public:
+    typedef std::array<uint32_t, 4> Block;
+  
+  private:
+    uint64_t m_ulKey;
+    uint64_t m_ulStream;
+    uint64_t m_ulCounter;
+    Block m_blkBuffer;
+    unsigned int m_unUsed;
+    float m_fSpareNormal;
+    bool m_bHasSpareNormal;
+    
+    uint32_t next();
+  
+  protected:
+  public:
+    Random(uint64_t ulSeed, uint64_t ulStream = 0);
+    ~Random();
+    
+    static Block philox(Block blkCounter, uint64_t ulKey);
+    
+    // Uniform in (0, 1]
+    float uniform();
+    // Standard normal (Box-Muller)
+    float normal();
+    void uniforms(float* pfValues, unsigned int unCount);
+    void normals(float* pfValues, unsigned int unCount);
+  };
+  
+  // Walker's alias method: O(n) setup, then O(1) per draw from the
+  // discrete distribution given by (not necessarily normalized,
+  // non-negative) weights.
+  class AliasTable {
+  private:
+    std::vector<float> m_vecProbabilities;
+    std::vector<unsigned int> m_vecAliases;
+  
+  protected:
+  public:
+    AliasTable(const std::vector<double>& vecWeights);
+    ~AliasTable();
+    
+    unsigned int size();
+    unsigned int draw(Random& rndRandom);
+  };
+}
+
+
+#endif /* __RANDOM_H__ */
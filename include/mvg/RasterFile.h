@@ -0,0 +1,65 @@
+#ifndef __RASTERFILE_H__
+#define __RASTERFILE_H__
+
+
+#include <memory>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <mvg/Grid.hpp>
+
+
+namespace mvg {
+  // Output of rasterized densities. Besides the `x, y, p` text lines
+  // used so far, a grid can be written as a binary raster:
+  //
+  //   Header (32 bytes, native byte order)
+  //     char[4]  magic ("MVGR")
+  //     uint32   format version
+  //     float32  origin x, origin y
+  //     float32  step x, step y
+  //     uint32   cell count along x, along y
+  //   Values (float32), one row of constant x after the other, i.e.
+  //   in the order of the text lines
+  //
+  // gnuplot reads it directly (see `scripts/plot_raster.plt`) with
+  //   binary skip=32 array=(countY, countX) format='%float32'
+  // and the origin and steps from the header.
+  class RasterFile {
+  public:
+    typedef enum {
+      CSV = 0,
+      Binary = 1
+    } Format;
+    
+    typedef struct {
+      char acMagic[4];
+      uint32_t unVersion;
+      float fOriginX;
+      float fOriginY;
+      float fStepX;
+      float fStepY;
+      uint32_t unCountX;
+      uint32_t unCountY;
+    } Header;
+    
+  private:
+  protected:
+  public:
+    // Binary for files ending in `.mvgr`, text otherwise.
+    static Format formatFor(std::string strFilepath);
+    
+    static bool writeCSV(std::ostream& osStream, Grid grdGrid, const float* pfValues);
+    static bool writeBinary(std::ostream& osStream, Grid grdGrid, const float* pfValues);
+    static bool write(std::ostream& osStream, Grid grdGrid, const float* pfValues, Format fmtFormat);
+    static bool write(std::string strFilepath, Grid grdGrid, const float* pfValues);
+    static bool write(std::string strFilepath, Grid grdGrid, std::vector<float>& vecValues);
+    
+    static bool read(std::string strFilepath, Grid& grdGrid, std::vector<float>& vecValues);
+  };
+}
+
+
+#endif /* __RASTERFILE_H__ */
@@ -0,0 +1,157 @@
+#ifndef __STATISTICS_HPP__
+#define __STATISTICS_HPP__
+
+
+#include <memory>
+#include <iostream>
+
+#include <Eigen/Dense>
+
+
+namespace mvg {
+  // Sufficient statistics (count, mean and scatter matrix) of a stream
+  // of samples. Samples can be added one by one (Welford's update) or
+  // in blocks (block statistics merged in with Chan's update), so the
+  // mean and covariance are available after a single pass and stay
+  // valid as more samples arrive. Accumulation is done in double
+  // precision regardless of the sample type. The per-dimension minimum
+  // and maximum are tracked along, except for samples merged in as
+  // bare (count, mean, scatter) statistics.
+  class Statistics {
+  public:
+    typedef std::shared_ptr<Statistics> Ptr;
+  
+  private:
+    unsigned long m_ulCount;
+    Eigen::VectorXd m_vxMean;
+    Eigen::MatrixXd m_mxScatter;
+    Eigen::VectorXd m_vxMinimum;
+    Eigen::VectorXd m_vxMaximum;
+    
+    void extend(const Eigen::VectorXd& vxMinimum, const Eigen::VectorXd& vxMaximum) {
+      if(m_vxMinimum.size() == 0) {
+	m_vxMinimum = vxMinimum;
+	m_vxMaximum = vxMaximum;
+      } else {
+	m_vxMinimum = m_vxMinimum.cwiseMin(vxMinimum);
+	m_vxMaximum = m_vxMaximum.cwiseMax(vxMaximum);
+      }
+    }
+  
+  protected:
+  public:
+    Statistics() : m_ulCount(0) {
+    }
+    
+    ~Statistics() {
+    }
+    
+    void clear() {
+      m_ulCount = 0;
+      m_vxMean.resize(0);
+      m_mxScatter.resize(0, 0);
+      m_vxMinimum.resize(0);
+      m_vxMaximum.resize(0);
+    }
+    
+    unsigned int dimension() {
+      return m_vxMean.size();
+    }
+    
+    unsigned long count() {
+      return m_ulCount;
+    }
+    
+    template<typename Derived>
+      void add(const Eigen::MatrixBase<Derived>& vxSample) {
+      if(m_ulCount == 0) {
+	m_vxMean = Eigen::VectorXd::Zero(vxSample.size());
+	m_mxScatter = Eigen::MatrixXd::Zero(vxSample.size(), vxSample.size());
+      }
+      
+      m_ulCount++;
+      this->extend(vxSample.template cast<double>(), vxSample.template cast<double>());
+      
+      Eigen::VectorXd vxDelta = vxSample.template cast<double>() - m_vxMean;
+      m_vxMean += vxDelta / (double)m_ulCount;
+      m_mxScatter.noalias() += vxDelta * (vxSample.template cast<double>() - m_vxMean).transpose();
+    }
+    
+    template<typename Derived>
+      void addBlock(const Eigen::MatrixBase<Derived>& mxSamples) {
+      // One sample per column.
+      if(mxSamples.cols() > 0) {
+	Eigen::MatrixXd mxBlock = mxSamples.template cast<double>();
+	Eigen::VectorXd vxBlockMean = mxBlock.rowwise().mean();
+	this->extend(mxBlock.rowwise().minCoeff(), mxBlock.rowwise().maxCoeff());
+	mxBlock.colwise() -= vxBlockMean;
+	
+	Eigen::MatrixXd mxBlockScatter = Eigen::MatrixXd::Zero(mxBlock.rows(), mxBlock.rows());
+	mxBlockScatter.selfadjointView<Eigen::Lower>().rankUpdate(mxBlock);
+	mxBlockScatter.triangularView<Eigen::StrictlyUpper>() = mxBlockScatter.transpose();
+	
+	this->merge(mxSamples.cols(), vxBlockMean, mxBlockScatter);
+      }
+    }
+    
+    void merge(unsigned long ulCount, const Eigen::VectorXd& vxMean, const Eigen::MatrixXd& mxScatter) {
+      if(ulCount == 0) {
+	return;
+      }
+      
+      if(m_ulCount == 0) {
+	m_ulCount = ulCount;
+	m_vxMean = vxMean;
+	m_mxScatter = mxScatter;
+      } else {
+	double dTotal = (double)(m_ulCount + ulCount);
+	Eigen::VectorXd vxDelta = vxMean - m_vxMean;
+	
+	m_vxMean += vxDelta * ((double)ulCount / dTotal);
+	m_mxScatter += mxScatter + (vxDelta * vxDelta.transpose()) * ((double)m_ulCount * (double)ulCount / dTotal);
+	m_ulCount += ulCount;
+      }
+    }
+    
+    void merge(Statistics& stOther) {
+      if(stOther.m_vxMinimum.size() > 0) {
+	this->extend(stOther.m_vxMinimum, stOther.m_vxMaximum);
+      }
+      
+      this->merge(stOther.m_ulCount, stOther.m_vxMean, stOther.m_mxScatter);
+    }
+    
+    Eigen::VectorXd mean() {
+      return m_vxMean;
+    }
+    
+    Eigen::MatrixXd scatter() {
+      return m_mxScatter;
+    }
+    
+    Eigen::VectorXd minimum() {
+      return m_vxMinimum;
+    }
+    
+    Eigen::VectorXd maximum() {
+      return m_vxMaximum;
+    }
+    
+    Eigen::MatrixXd covariance() {
+      // Maximum likelihood estimate (normalized by the sample count).
+      if(m_ulCount == 0) {
+	return m_mxScatter;
+      }
+      
+      return m_mxScatter / (double)m_ulCount;
+    }
+    
+    template<class ... Args>
+      static Statistics::Ptr create(Args ... args) {
+      return std::make_shared<Statistics>(std::forward<Args>(args)...);
+    }
+  };
+}
+
+
+#endif /* __STATISTICS_HPP__ */
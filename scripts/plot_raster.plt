@@ -0,0 +1,21 @@
+# Expects `file`, `output`, `originX`, `originY`, `stepX`, `stepY`,
+# `countX` and `countY` to be set (see plot_raster.sh).
+set terminal pdf
+set output output
+
+set style fill solid
+set style fill solid border -1
+set xtic scale 0
+
+set key off
+
+set xlabel "X"
+set ylabel "Y"
+
+set title "Gaussian Mixture Distribution Heatmap"
+
+set palette defined (0 "blue", 17 "#00ffff", 33 "white", 50 "yellow", 66 "red", 100 "#990000", 101 "grey")
+
+# Values are stored with y running fastest, so the first array
+# dimension is y; `using 2:1:3` puts it back on the vertical axis.
+eval sprintf("plot file binary skip=32 array=(%d,%d) format='%%float32' origin=(%g,%g) dx=%g dy=%g using 2:1:3 w image", countY, countX, originY, originX, stepY, stepX)
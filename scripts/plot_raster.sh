@@ -0,0 +1,12 @@
+#!/bin/bash
+
+# Plots a binary raster (`.mvgr`) as written by the drivers and the
+# JNI interface; usage: ./plot_raster.sh <raster file> [output pdf]
+
+FILE=$1
+OUTPUT=${2:-../heatmap_raster.pdf}
+
+read ORIGIN_X ORIGIN_Y STEP_X STEP_Y <<< $(od -A n -t f4 -j 8 -N 16 "$FILE")
+read COUNT_X COUNT_Y <<< $(od -A n -t u4 -j 24 -N 8 "$FILE")
+
+gnuplot -e "file='$FILE'; output='$OUTPUT'; originX=$ORIGIN_X; originY=$ORIGIN_Y; stepX=$STEP_X; stepY=$STEP_Y; countX=$COUNT_X; countY=$COUNT_Y" plot_raster.plt
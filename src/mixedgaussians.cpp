@@ -6,6 +6,7 @@
 #include <Eigen/Dense>
 
 #include <mvg/MixedGaussians.hpp>
+#include <mvg/GridRasterizer.hpp>
 #include <mvg/JSON.h>
 
 /*int main(int argc, char** argv) {
@@ -16,52 +17,49 @@ int mvg::MixedGaussiansDriver::runJNIMethod(char* fileName)
 {
   int nReturnvalue = EXIT_SUCCESS;
 
-  std::ofstream outputFile;
-  outputFile.open(fileName);
-
   mvg::MixedGaussians<float> mgGaussians = mvg::MixedGaussiansDriver::createMixedGaussians();
   
   mvg::MultiVarGauss<float>::Rect rctBoundingBox = mgGaussians.boundingBox();
-  mvg::MultiVarGauss<float>::DensityFunction fncDensity = mgGaussians.densityFunction();
   
   float fStepSizeX = 0.01;
   float fStepSizeY = 0.01;
   
-  for(float fX = rctBoundingBox.vecMin[0]; fX < rctBoundingBox.vecMax[0]; fX += fStepSizeX) {
-    for(float fY = rctBoundingBox.vecMin[1]; fY < rctBoundingBox.vecMax[1]; fY += fStepSizeY) {
-      float fValue = fncDensity({fX, fY});
-      
-      outputFile << fX << ", " << fY << ", " << fValue << std::endl;
-    }
+  mvg::Grid grdGrid = mvg::Grid::fromBoundingBox(rctBoundingBox.vecMin[0], rctBoundingBox.vecMin[1], rctBoundingBox.vecMax[0], rctBoundingBox.vecMax[1], fStepSizeX, fStepSizeY);
+  mvg::GridRasterizer<float> grsRasterizer(grdGrid);
+  std::vector<float> vecDensities;
+  
+  grsRasterizer.addMixture(mgGaussians);
+  grsRasterizer.rasterize(vecDensities);
+  
+  if(!mvg::RasterFile::write(fileName, grdGrid, vecDensities)) {
+    nReturnvalue = EXIT_FAILURE;
   }
- 
-  outputFile.close();  
 
   return nReturnvalue;
 
 }
 
 
-int mvg::MixedGaussiansDriver::runMainMethod()
+int mvg::MixedGaussiansDriver::runMainMethod(mvg::RasterFile::Format fmtFormat)
 {
   int nReturnvalue = EXIT_SUCCESS;
 
   mvg::MixedGaussians<float> mgGaussians = mvg::MixedGaussiansDriver::createMixedGaussians();
 
   mvg::MultiVarGauss<float>::Rect rctBoundingBox = mgGaussians.boundingBox();
-  mvg::MultiVarGauss<float>::DensityFunction fncDensity = mgGaussians.densityFunction();
   
   // Two dimensional case
   float fStepSizeX = 0.01;
   float fStepSizeY = 0.01;
   
-  for(float fX = rctBoundingBox.vecMin[0]; fX < rctBoundingBox.vecMax[0]; fX += fStepSizeX) {
-    for(float fY = rctBoundingBox.vecMin[1]; fY < rctBoundingBox.vecMax[1]; fY += fStepSizeY) {
-      float fValue = fncDensity({fX, fY});
-      
-      std::cout << fX << ", " << fY << ", " << fValue << std::endl;
-    }
-  }
+  mvg::Grid grdGrid = mvg::Grid::fromBoundingBox(rctBoundingBox.vecMin[0], rctBoundingBox.vecMin[1], rctBoundingBox.vecMax[0], rctBoundingBox.vecMax[1], fStepSizeX, fStepSizeY);
+  mvg::GridRasterizer<float> grsRasterizer(grdGrid);
+  std::vector<float> vecDensities;
+  
+  grsRasterizer.addMixture(mgGaussians);
+  grsRasterizer.rasterize(vecDensities);
+  
+  mvg::RasterFile::write(std::cout, grdGrid, vecDensities.data(), fmtFormat);
   
   /*std::cout << "Min :";
   for(float fValue : rctBoundingBox.vecMin) {
@@ -86,8 +84,6 @@ mvg::MixedGaussians<float> mvg::MixedGaussiansDriver::createMixedGaussians()
   // though; for example the code for handling nominal values and the
   // parts that load data from files.
   
-  srand(time(NULL));
-  
   mvg::MixedGaussians<float> mgGaussians;
   
   unsigned int unSampleDimensions = 2;
@@ -96,20 +92,25 @@ mvg::MixedGaussians<float> mvg::MixedGaussiansDriver::createMixedGaussians()
   std::vector<int> vecSampleCounts = {1500, 1500};
   
   for(unsigned int unI = 0; unI < vecMeans.size(); ++unI) {
-    mvg::MultiVarGauss<float>::Ptr mvgGaussian = mvg::MultiVarGauss<float>::create();
-    mvg::Dataset::Ptr dsDataset = mvg::Dataset::create();
-    mvgGaussian->setDataset(dsDataset);
-    mgGaussians.addGaussian(mvgGaussian, 1.0);
+    // Synthetic samples of a known Gaussian (standard deviations of
+    // half the spread), fitted again by the component
+    mvg::MultiVarGauss<float> mvgSource;
+    Eigen::VectorXd vxMean(unSampleDimensions);
+    Eigen::VectorXd vxVariances(unSampleDimensions);
+    std::vector<float> vecSamples(vecSampleCounts[unI] * unSampleDimensions);
     
-    for(unsigned int unSample = 0; unSample < vecSampleCounts[unI]; ++unSample) {
-      std::vector<float> vecSample;
-      
-      for(unsigned int unDimension = 0; unDimension < unSampleDimensions; ++unDimension) {
-	vecSample.push_back(vecMeans[unI][unDimension] + ((((double)rand() / (double)RAND_MAX) * vecSpreads[unI][unDimension]) - vecSpreads[unI][unDimension] / 2.0));
-      }
-      
-      mvg::MultiVarGauss<float>::addToDataset(dsDataset, vecSample);
+    for(unsigned int unDimension = 0; unDimension < unSampleDimensions; ++unDimension) {
+      vxMean[unDimension] = vecMeans[unI][unDimension];
+      vxVariances[unDimension] = vecSpreads[unI][unDimension] * vecSpreads[unI][unDimension] / 4.0;
     }
+    
+    mvgSource.setParameters(vxMean, vxVariances.asDiagonal().toDenseMatrix());
+    mvgSource.draw(vecSamples.data(), vecSampleCounts[unI], unI);
+    
+    mvg::MultiVarGauss<float>::Ptr mvgGaussian = mvg::MultiVarGauss<float>::create();
+    mvgGaussian->setDataset(mvg::Dataset::create());
+    mvgGaussian->addSamples(vecSamples.data(), vecSampleCounts[unI], unSampleDimensions);
+    mgGaussians.addGaussian(mvgGaussian, 1.0);
   }
   
   return mgGaussians;
@@ -6,30 +6,10 @@
 #include <Eigen/Dense>
 
 #include <mvg/MultiVarGauss.hpp>
-#include <mvg/JSON.h>
+#include <mvg/GridRasterizer.hpp>
+#include <mvg/DatasetFile.h>
 
 
-unsigned int mvg::MultiVarGaussDriver::nominalValue(unsigned int unRow, std::string strValue) {
-  std::map<std::string, unsigned int>& mapRow = mapNominalValues[unRow];
-  
-  if(mapRow.find(strValue) != mapRow.end()) {
-    return mapRow[strValue];
-  } else {
-    unsigned int unNextHigher = 0;
-    
-    for(std::map<std::string, unsigned int>::iterator itPair = mapRow.begin();
-	itPair != mapRow.end(); ++itPair) {
-      if(itPair->second >= unNextHigher) {
-	unNextHigher = itPair->second + 1;
-      }
-    }
-    
-    mapRow[strValue] = unNextHigher;
-    
-    return unNextHigher;
-  }
-}
-
 mvg::MultiVarGauss<float> mvg::MultiVarGaussDriver::createMultiVarGauss(char* inputName)
 {
   mvg::MultiVarGauss<float> mvgMain;
@@ -37,65 +17,53 @@ mvg::MultiVarGauss<float> mvg::MultiVarGaussDriver::createMultiVarGauss(char* in
   srand(time(NULL));
   
   std::string strFile = inputName;
-  std::ifstream ifFile(strFile.c_str());
   
-  if(ifFile.good()) {
-    mvg::JSON jsnJSON;
-    std::string strLine;
-      
-    mvg::Dataset::Ptr dsData = mvg::Dataset::create();
+  // Binary files (see `mvg::DatasetFile`) are mapped as they are; any
+  // other input is read as JSON lines, whatever its extension. Their
+  // last column is Z, which isn't modelled.
+  mvg::Dataset::Ptr dsData;
+  
+  if(mvg::DatasetFile::isBinary(strFile)) {
+    dsData = mvg::DatasetFile::mapBinary(strFile);
+  } else {
+    dsData = mvg::DatasetFile::loadJSONLines(strFile);
+    
+    if(dsData && dsData->dimension() > 1) {
+      std::vector<unsigned int> vecUsedIndices;
       
-    while(std::getline(ifFile, strLine)) {
-      jsnJSON.parse(strLine);
-      mvg::Property* prRoot = jsnJSON.rootProperty();
-	
-      if(prRoot->type() == mvg::Property::Array) {
-	std::vector<mvg::Property*> vecRows = prRoot->subProperties();
-        std::vector<float> vecValues;
-	  
-	for(unsigned int unRow = 0; unRow < vecRows.size() - 1 /* Ignore Z */; ++unRow) {
-	  mvg::Property* prSub = vecRows[unRow];
-	    
-	  float fValue = 0.0;
-	    
-          switch(prSub->type()) {
-	    case mvg::Property::Integer: fValue = (float)prSub->getInteger(); break;
-	    case mvg::Property::Double: fValue = (float)prSub->getDouble(); break;
-	    case mvg::Property::String: fValue = (float)nominalValue(unRow, prSub->getString()); break;
-	    default: break;
-	  }
-	    
-	  vecValues.push_back(fValue);
-	}
-	  
-	mvg::MultiVarGauss<float>::addToDataset(dsData, vecValues);
+      for(unsigned int unColumn = 0; unColumn < dsData->dimension() - 1; ++unColumn) {
+	vecUsedIndices.push_back(unColumn);
       }
+      
+      dsData = mvg::DatasetFile::selectColumns(dsData, vecUsedIndices);
     }
-    mvgMain.setDataset(dsData);
   }
-  else {
+  
+  if(dsData) {
+    mvgMain.setDataset(dsData);
+  } else {
     std::cerr << "Couldn't open file '" << strFile << "'" << std::endl;
   }
-
+  
   return mvgMain;
 }
 
 
-int mvg::MultiVarGaussDriver::runMainMethod(char* inputName)
+int mvg::MultiVarGaussDriver::runMainMethod(char* inputName, mvg::RasterFile::Format fmtFormat)
 {
   mvg::MultiVarGauss<float> mvgMain = createMultiVarGauss(inputName);
       
-  mvg::MultiVarGauss<float>::DensityFunction fncDensity = mvgMain.densityFunction();
-      
   int nBoundary = 2.0;
-      
-  for(float fX = 0.1; fX <= 1.2; fX += 0.01) {
-    for(float fY = -0.5; fY <= 1.0; fY += 0.01) {
-      float fValue = fncDensity({0, fX, fY});
-	  
-      std::cout << fX << ", " << fY << ", " << fValue << std::endl;
-    }
-  }
+  
+  // Slice through x = 0 along the second and third dimension.
+  mvg::Grid grdGrid = mvg::Grid::fromBoundingBox(0.1, -0.5, 1.2, 1.0, 0.01, 0.01, true);
+  mvg::GridRasterizer<float> grsRasterizer(grdGrid, 1, 2, {0, 0, 0});
+  std::vector<float> vecDensities;
+  
+  grsRasterizer.addGaussian(mvgMain);
+  grsRasterizer.rasterize(vecDensities);
+  
+  mvg::RasterFile::write(std::cout, grdGrid, vecDensities.data(), fmtFormat);
       
   return EXIT_SUCCESS;
 
@@ -103,26 +71,22 @@ int mvg::MultiVarGaussDriver::runMainMethod(char* inputName)
 
 int mvg::MultiVarGaussDriver::runJNIMethod(char* inputName, char* outputName)
 {
-  std::ofstream outputFile;
-  outputFile.open(outputName);
-
-
   mvg::MultiVarGauss<float> mvgMain = createMultiVarGauss(inputName);
       
-  mvg::MultiVarGauss<float>::DensityFunction fncDensity = mvgMain.densityFunction();
-      
   int nBoundary = 2.0;
-      
-  for(float fX = 0.1; fX <= 1.2; fX += 0.01) {
-    for(float fY = -0.5; fY <= 1.0; fY += 0.01) {
-      float fValue = fncDensity({0, fX, fY});
-	  
-      outputFile << fX << ", " << fY << ", " << fValue << std::endl;
-    }
+  
+  // Slice through x = 0 along the second and third dimension.
+  mvg::Grid grdGrid = mvg::Grid::fromBoundingBox(0.1, -0.5, 1.2, 1.0, 0.01, 0.01, true);
+  mvg::GridRasterizer<float> grsRasterizer(grdGrid, 1, 2, {0, 0, 0});
+  std::vector<float> vecDensities;
+  
+  grsRasterizer.addGaussian(mvgMain);
+  grsRasterizer.rasterize(vecDensities);
+  
+  if(!mvg::RasterFile::write(outputName, grdGrid, vecDensities)) {
+    return EXIT_FAILURE;
   }
 
-  outputFile.close();      
-
   return EXIT_SUCCESS;
 
 }
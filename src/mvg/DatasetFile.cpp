@@ -0,0 +1,364 @@
+#include <mvg/DatasetFile.h>
+
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <mvg/JSON.h>
+
+
+namespace mvg {
+  static const char* s_acMagic = "MVGD";
+  static const uint32_t s_unVersion = 1;
+  static const uint32_t s_unDataAlignment = 64;
+  
+  static std::vector<std::string> tokenizeCSVLine(std::string strLine) {
+    std::vector<std::string> vecTokens;
+    
+    char* cToken = std::strtok((char*)strLine.c_str(), ",");
+    while(cToken != nullptr) {
+      vecTokens.push_back(cToken);
+      cToken = std::strtok(NULL, ",");
+    }
+    
+    return vecTokens;
+  }
+  
+  static bool isUsedIndex(std::vector<unsigned int>& vecUsedIndices, unsigned int unIndex) {
+    return vecUsedIndices.size() == 0 || std::find(vecUsedIndices.begin(), vecUsedIndices.end(), unIndex) != vecUsedIndices.end();
+  }
+  
+  std::vector<float> DatasetFile::selectColumns(std::vector<float> vecRow, std::vector<unsigned int> vecUsedIndices) {
+    std::vector<float> vecSelected;
+    
+    for(unsigned int unI = 0; unI < vecRow.size(); ++unI) {
+      if(isUsedIndex(vecUsedIndices, unI)) {
+	vecSelected.push_back(vecRow[unI]);
+      }
+    }
+    
+    return vecSelected;
+  }
+  
+  Dataset::Ptr DatasetFile::loadCSV(std::string strFilepath, std::vector<unsigned int> vecUsedIndices) {
+    Dataset::Ptr dsData = nullptr;
+    
+    std::ifstream ifFile(strFilepath, std::ios::in);
+    
+    if(ifFile.good()) {
+      dsData = Dataset::create();
+      
+      std::string strLine;
+      std::getline(ifFile, strLine); // Header
+      
+      std::vector<std::string> vecColumnNames;
+      std::vector<std::string> vecHeaderTokens = tokenizeCSVLine(strLine);
+      for(unsigned int unI = 0; unI < vecHeaderTokens.size(); ++unI) {
+	if(isUsedIndex(vecUsedIndices, unI)) {
+	  vecColumnNames.push_back(vecHeaderTokens[unI]);
+	}
+      }
+      
+      std::vector<float> vecData;
+      while(std::getline(ifFile, strLine)) {
+	std::vector<std::string> vecTokens = tokenizeCSVLine(strLine);
+	
+	vecData.clear();
+	for(unsigned int unI = 0; unI < vecTokens.size(); ++unI) {
+	  if(isUsedIndex(vecUsedIndices, unI)) {
+	    const char* cToken = vecTokens[unI].c_str();
+	    char* cEnd = nullptr;
+	    double dValue = std::strtod(cToken, &cEnd);
+	    
+	    vecData.push_back(cEnd == cToken ? 0.0 : dValue);
+	  }
+	}
+	
+	if(vecData.size() > 0 && (dsData->dimension() == 0 || vecData.size() == dsData->dimension())) {
+	  dsData->add(Eigen::Map<Eigen::VectorXf>(vecData.data(), vecData.size()));
+	}
+      }
+      
+      if(vecColumnNames.size() == dsData->dimension()) {
+	dsData->setColumnNames(vecColumnNames);
+      }
+    }
+    
+    return dsData;
+  }
+  
+  Dataset::Ptr DatasetFile::loadJSONLines(std::string strFilepath, std::vector<unsigned int> vecUsedIndices) {
+    Dataset::Ptr dsData = nullptr;
+    
+    std::ifstream ifFile(strFilepath, std::ios::in);
+    
+    if(ifFile.good()) {
+      dsData = Dataset::create();
+      
+      // Strings are nominal values; they are numbered per column in
+      // order of appearance.
+      std::map<unsigned int, std::map<std::string, unsigned int>> mapNominalValues;
+      
+      JSON jsnJSON;
+      std::string strLine;
+      
+      while(std::getline(ifFile, strLine)) {
+	jsnJSON.parse(strLine);
+	Property* prRoot = jsnJSON.rootProperty();
+	
+	if(prRoot->type() == Property::Array) {
+	  std::vector<Property*> vecColumns = prRoot->subProperties();
+	  std::vector<float> vecValues;
+	  
+	  for(unsigned int unColumn = 0; unColumn < vecColumns.size(); ++unColumn) {
+	    Property* prSub = vecColumns[unColumn];
+	    float fValue = 0.0;
+	    
+	    switch(prSub->type()) {
+	    case Property::Integer: fValue = (float)prSub->getInteger(); break;
+	    case Property::Double: fValue = (float)prSub->getDouble(); break;
+	    case Property::Boolean: fValue = (prSub->getBoolean() ? 1.0 : 0.0); break;
+	    
+	    case Property::String: {
+	      std::map<std::string, unsigned int>& mapColumn = mapNominalValues[unColumn];
+	      
+	      if(mapColumn.find(prSub->getString()) == mapColumn.end()) {
+		unsigned int unNext = mapColumn.size();
+		mapColumn[prSub->getString()] = unNext;
+	      }
+	      
+	      fValue = (float)mapColumn[prSub->getString()];
+	    } break;
+	    
+	    default: break;
+	    }
+	    
+	    vecValues.push_back(fValue);
+	  }
+	  
+	  vecValues = selectColumns(vecValues, vecUsedIndices);
+	  
+	  if(vecValues.size() > 0 && (dsData->dimension() == 0 || vecValues.size() == dsData->dimension())) {
+	    dsData->add(Eigen::Map<Eigen::VectorXf>(vecValues.data(), vecValues.size()));
+	  }
+	}
+      }
+    }
+    
+    return dsData;
+  }
+  
+  bool DatasetFile::isBinary(std::string strFilepath) {
+    std::ifstream ifFile(strFilepath, std::ios::in | std::ios::binary);
+    char acMagic[4];
+    
+    if(ifFile.good() && ifFile.read(acMagic, 4)) {
+      return std::memcmp(acMagic, s_acMagic, 4) == 0;
+    }
+    
+    return false;
+  }
+  
+  bool DatasetFile::writeBinary(Dataset::Ptr dsData, std::string strFilepath) {
+    std::ofstream ofFile(strFilepath, std::ios::out | std::ios::binary | std::ios::trunc);
+    
+    if(!ofFile.good()) {
+      std::cerr << "Couldn't open file '" << strFilepath << "' for writing" << std::endl;
+      return false;
+    }
+    
+    std::string strNames;
+    for(std::string strName : dsData->columnNames()) {
+      strNames += strName;
+      strNames.push_back('\0');
+    }
+    
+    Header hdrHeader;
+    std::memcpy(hdrHeader.acMagic, s_acMagic, 4);
+    hdrHeader.unVersion = s_unVersion;
+    hdrHeader.unScalarType = Float32;
+    hdrHeader.unDimension = dsData->dimension();
+    hdrHeader.ulCount = dsData->count();
+    hdrHeader.unNamesSize = strNames.size();
+    hdrHeader.unDataOffset = ((sizeof(Header) + strNames.size() + s_unDataAlignment - 1) / s_unDataAlignment) * s_unDataAlignment;
+    
+    std::vector<char> vecPadding(hdrHeader.unDataOffset - sizeof(Header) - strNames.size(), 0);
+    
+    ofFile.write((const char*)&hdrHeader, sizeof(Header));
+    ofFile.write(strNames.data(), strNames.size());
+    ofFile.write(vecPadding.data(), vecPadding.size());
+    ofFile.write((const char*)dsData->data(), sizeof(float) * hdrHeader.ulCount * hdrHeader.unDimension);
+    
+    return ofFile.good();
+  }
+  
+  Dataset::Ptr DatasetFile::mapBinary(std::string strFilepath) {
+    int nFile = open(strFilepath.c_str(), O_RDONLY);
+    
+    if(nFile < 0) {
+      std::cerr << "Couldn't open file '" << strFilepath << "'" << std::endl;
+      return nullptr;
+    }
+    
+    struct stat stStat;
+    if(fstat(nFile, &stStat) != 0 || (size_t)stStat.st_size < sizeof(Header)) {
+      std::cerr << "Not a binary dataset: '" << strFilepath << "'" << std::endl;
+      close(nFile);
+      return nullptr;
+    }
+    
+    // A private mapping lets callers modify samples in place without
+    // ever touching the file (pages are copied on write).
+    size_t szSize = stStat.st_size;
+    void* vdMapped = mmap(nullptr, szSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, nFile, 0);
+    close(nFile);
+    
+    if(vdMapped == MAP_FAILED) {
+      std::cerr << "Couldn't map file '" << strFilepath << "'" << std::endl;
+      return nullptr;
+    }
+    
+    std::shared_ptr<void> shpMapping(vdMapped, [szSize](void* vdAddress) {
+	munmap(vdAddress, szSize);
+      });
+    
+    Header hdrHeader;
+    std::memcpy(&hdrHeader, vdMapped, sizeof(Header));
+    
+    size_t szScalar = (hdrHeader.unScalarType == Float64 ? sizeof(double) : sizeof(float));
+    
+    // The sample block size is checked by division, so that huge
+    // (corrupt) counts can't overflow the comparison.
+    if(std::memcmp(hdrHeader.acMagic, s_acMagic, 4) != 0 ||
+       hdrHeader.unVersion != s_unVersion ||
+       hdrHeader.unScalarType > Float64 ||
+       hdrHeader.ulCount > 0xffffffffUL ||
+       (uint64_t)hdrHeader.unDataOffset < sizeof(Header) + (uint64_t)hdrHeader.unNamesSize ||
+       szSize < hdrHeader.unDataOffset ||
+       (hdrHeader.unDimension > 0 && hdrHeader.ulCount > (szSize - hdrHeader.unDataOffset) / szScalar / hdrHeader.unDimension)) {
+      std::cerr << "Not a valid binary dataset: '" << strFilepath << "'" << std::endl;
+      return nullptr;
+    }
+    
+    std::vector<std::string> vecColumnNames;
+    const char* cNames = (const char*)vdMapped + sizeof(Header);
+    for(uint32_t unOffset = 0; unOffset < hdrHeader.unNamesSize; ) {
+      size_t szLength = strnlen(cNames + unOffset, hdrHeader.unNamesSize - unOffset);
+      
+      if(szLength == hdrHeader.unNamesSize - unOffset) {
+	std::cerr << "Unterminated column name in binary dataset: '" << strFilepath << "'" << std::endl;
+	return nullptr;
+      }
+      
+      vecColumnNames.push_back(std::string(cNames + unOffset, szLength));
+      unOffset += szLength + 1;
+    }
+    
+    char* cData = (char*)vdMapped + hdrHeader.unDataOffset;
+    Dataset::Ptr dsData = nullptr;
+    
+    if(hdrHeader.unScalarType == Float32) {
+      dsData = Dataset::create((float*)cData, (unsigned int)hdrHeader.unDimension, (unsigned int)hdrHeader.ulCount, shpMapping);
+    } else {
+      // Double precision files can't be used in place; convert them.
+      dsData = Dataset::create((unsigned int)hdrHeader.unDimension);
+      dsData->reserve(hdrHeader.ulCount);
+      
+      Eigen::Map<Eigen::MatrixXd> mxSource((double*)cData, hdrHeader.unDimension, hdrHeader.ulCount);
+      for(unsigned int unI = 0; unI < hdrHeader.ulCount; ++unI) {
+	dsData->add(mxSource.col(unI).cast<float>());
+      }
+    }
+    
+    if(vecColumnNames.size() == dsData->dimension()) {
+      dsData->setColumnNames(vecColumnNames);
+    }
+    
+    return dsData;
+  }
+  
+  Dataset::Ptr DatasetFile::load(std::string strFilepath, std::vector<unsigned int> vecUsedIndices) {
+    if(DatasetFile::isBinary(strFilepath)) {
+      Dataset::Ptr dsMapped = DatasetFile::mapBinary(strFilepath);
+      
+      if(!dsMapped) {
+	return dsMapped;
+      }
+      
+      return DatasetFile::selectColumns(dsMapped, vecUsedIndices);
+    }
+    
+    size_t szDot = strFilepath.find_last_of(".");
+    if(szDot != std::string::npos && strFilepath.substr(szDot) == ".json") {
+      return DatasetFile::loadJSONLines(strFilepath, vecUsedIndices);
+    }
+    
+    return DatasetFile::loadCSV(strFilepath, vecUsedIndices);
+  }
+  
+  Dataset::Ptr DatasetFile::selectColumns(Dataset::Ptr dsData, std::vector<unsigned int> vecUsedIndices) {
+    // Column subsets need their own (copied) storage.
+    std::vector<unsigned int> vecColumns;
+    for(unsigned int unI = 0; unI < dsData->dimension(); ++unI) {
+      if(isUsedIndex(vecUsedIndices, unI)) {
+	vecColumns.push_back(unI);
+      }
+    }
+    
+    if(vecColumns.size() == dsData->dimension()) {
+      return dsData;
+    }
+    
+    Dataset::Ptr dsSubset = Dataset::create((unsigned int)vecColumns.size());
+    dsSubset->reserve(dsData->count());
+    
+    Eigen::VectorXf vxRow(vecColumns.size());
+    for(unsigned int unI = 0; unI < dsData->count(); ++unI) {
+      for(unsigned int unC = 0; unC < vecColumns.size(); ++unC) {
+	vxRow[unC] = (*dsData)[unI][vecColumns[unC]];
+      }
+      
+      dsSubset->add(vxRow);
+    }
+    
+    std::vector<std::string> vecNames = dsData->columnNames();
+    if(vecNames.size() == dsData->dimension()) {
+      std::vector<std::string> vecSubsetNames;
+      for(unsigned int unC : vecColumns) {
+	vecSubsetNames.push_back(vecNames[unC]);
+      }
+      
+      dsSubset->setColumnNames(vecSubsetNames);
+    }
+    
+    return dsSubset;
+  }
+  
+  bool DatasetFile::convertCSV(std::string strFileIn, std::string strFileOut, std::vector<unsigned int> vecUsedIndices) {
+    Dataset::Ptr dsData = DatasetFile::loadCSV(strFileIn, vecUsedIndices);
+    
+    if(!dsData) {
+      std::cerr << "Couldn't open file '" << strFileIn << "'" << std::endl;
+      return false;
+    }
+    
+    return DatasetFile::writeBinary(dsData, strFileOut);
+  }
+  
+  bool DatasetFile::convertJSONLines(std::string strFileIn, std::string strFileOut, std::vector<unsigned int> vecUsedIndices) {
+    Dataset::Ptr dsData = DatasetFile::loadJSONLines(strFileIn, vecUsedIndices);
+    
+    if(!dsData) {
+      std::cerr << "Couldn't open file '" << strFileIn << "'" << std::endl;
+      return false;
+    }
+    
+    return DatasetFile::writeBinary(dsData, strFileOut);
+  }
+}
@@ -0,0 +1,253 @@
+#include <mvg/KDTree.h>
+
+#include <limits>
+#include <algorithm>
+
+
+namespace mvg {
+  KDTree::KDTree(Dataset::Ptr dsData, unsigned int unLeafSize) : m_dsData(dsData), m_unLeafSize(std::max(unLeafSize, 1u)) {
+    unsigned int unSamples = m_dsData->count();
+    
+    m_vecIndices.resize(unSamples);
+    for(unsigned int unSample = 0; unSample < unSamples; ++unSample) {
+      m_vecIndices[unSample] = unSample;
+    }
+    
+    if(unSamples > 0) {
+      m_vecNodes.reserve(4 * (unSamples / m_unLeafSize + 1));
+      this->build(0, unSamples);
+    }
+  }
+  
+  KDTree::~KDTree() {
+  }
+  
+  Dataset::Ptr KDTree::data() {
+    return m_dsData;
+  }
+  
+  int KDTree::build(unsigned int unBegin, unsigned int unEnd) {
+    Dataset::MatrixMap mxData = m_dsData->matrix();
+    int nNode = m_vecNodes.size();
+    
+    Node ndNode;
+    ndNode.unBegin = unBegin;
+    ndNode.unEnd = unEnd;
+    ndNode.nLeft = -1;
+    ndNode.nRight = -1;
+    ndNode.vxMin = mxData.col(m_vecIndices[unBegin]);
+    ndNode.vxMax = ndNode.vxMin;
+    ndNode.vxSum = Eigen::VectorXd::Zero(mxData.rows());
+    
+    for(unsigned int unI = unBegin; unI < unEnd; ++unI) {
+      ndNode.vxMin = ndNode.vxMin.cwiseMin(mxData.col(m_vecIndices[unI]));
+      ndNode.vxMax = ndNode.vxMax.cwiseMax(mxData.col(m_vecIndices[unI]));
+      ndNode.vxSum += mxData.col(m_vecIndices[unI]).cast<double>();
+    }
+    
+    Eigen::VectorXf::Index nAxis;
+    float fWidth = (ndNode.vxMax - ndNode.vxMin).maxCoeff(&nAxis);
+    m_vecNodes.push_back(ndNode);
+    
+    if(unEnd - unBegin > m_unLeafSize && fWidth > 0) {
+      unsigned int unMiddle = unBegin + (unEnd - unBegin) / 2;
+      
+      std::nth_element(m_vecIndices.begin() + unBegin, m_vecIndices.begin() + unMiddle, m_vecIndices.begin() + unEnd,
+		       [&](unsigned int unA, unsigned int unB) {
+			 return mxData(nAxis, unA) < mxData(nAxis, unB);
+		       });
+      
+      int nLeft = this->build(unBegin, unMiddle);
+      int nRight = this->build(unMiddle, unEnd);
+      
+      m_vecNodes[nNode].nLeft = nLeft;
+      m_vecNodes[nNode].nRight = nRight;
+    }
+    
+    return nNode;
+  }
+  
+  float KDTree::boxDistance(Node& ndNode, const Eigen::VectorXf& vxQuery) {
+    // Squared distance to the closest point of the node's box
+    return ((ndNode.vxMin - vxQuery).cwiseMax(0.0f) + (vxQuery - ndNode.vxMax).cwiseMax(0.0f)).squaredNorm();
+  }
+  
+  void KDTree::search(int nNode, const Eigen::VectorXf& vxQuery, unsigned int unK, std::vector<std::pair<float, unsigned int>>& vecHeap) {
+    // `vecHeap` is a max-heap of the best (squared distance, sample)
+    // pairs found so far
+    Node& ndNode = m_vecNodes[nNode];
+    
+    if(vecHeap.size() == unK && this->boxDistance(ndNode, vxQuery) >= vecHeap.front().first) {
+      return;
+    }
+    
+    if(ndNode.nLeft < 0) {
+      Dataset::MatrixMap mxData = m_dsData->matrix();
+      
+      for(unsigned int unI = ndNode.unBegin; unI < ndNode.unEnd; ++unI) {
+	float fDistance = (mxData.col(m_vecIndices[unI]) - vxQuery).squaredNorm();
+	
+	if(vecHeap.size() < unK) {
+	  vecHeap.push_back(std::make_pair(fDistance, m_vecIndices[unI]));
+	  std::push_heap(vecHeap.begin(), vecHeap.end());
+	} else if(fDistance < vecHeap.front().first) {
+	  std::pop_heap(vecHeap.begin(), vecHeap.end());
+	  vecHeap.back() = std::make_pair(fDistance, m_vecIndices[unI]);
+	  std::push_heap(vecHeap.begin(), vecHeap.end());
+	}
+      }
+    } else {
+      // Closer child first, so the far one is more likely pruned
+      int nNear = ndNode.nLeft;
+      int nFar = ndNode.nRight;
+      
+      if(this->boxDistance(m_vecNodes[nFar], vxQuery) < this->boxDistance(m_vecNodes[nNear], vxQuery)) {
+	std::swap(nNear, nFar);
+      }
+      
+      this->search(nNear, vxQuery, unK, vecHeap);
+      this->search(nFar, vxQuery, unK, vecHeap);
+    }
+  }
+  
+  void KDTree::collect(int nNode, const Eigen::VectorXf& vxQuery, float fRadiusSquared, std::vector<unsigned int>& vecResult) {
+    Node& ndNode = m_vecNodes[nNode];
+    
+    if(this->boxDistance(ndNode, vxQuery) > fRadiusSquared) {
+      return;
+    }
+    
+    if(ndNode.nLeft < 0) {
+      Dataset::MatrixMap mxData = m_dsData->matrix();
+      
+      for(unsigned int unI = ndNode.unBegin; unI < ndNode.unEnd; ++unI) {
+	if((mxData.col(m_vecIndices[unI]) - vxQuery).squaredNorm() <= fRadiusSquared) {
+	  vecResult.push_back(m_vecIndices[unI]);
+	}
+      }
+    } else {
+      this->collect(ndNode.nLeft, vxQuery, fRadiusSquared, vecResult);
+      this->collect(ndNode.nRight, vxQuery, fRadiusSquared, vecResult);
+    }
+  }
+  
+  unsigned int KDTree::nearest(Eigen::VectorXf vxQuery) {
+    std::vector<unsigned int> vecNearest = this->nearest(vxQuery, 1);
+    
+    return (vecNearest.size() > 0 ? vecNearest[0] : 0);
+  }
+  
+  std::vector<unsigned int> KDTree::nearest(Eigen::VectorXf vxQuery, unsigned int unK) {
+    std::vector<std::pair<float, unsigned int>> vecHeap;
+    std::vector<unsigned int> vecNearest;
+    
+    if(m_vecNodes.size() > 0 && unK > 0) {
+      vecHeap.reserve(unK);
+      this->search(0, vxQuery, unK, vecHeap);
+      std::sort_heap(vecHeap.begin(), vecHeap.end());
+      
+      for(std::pair<float, unsigned int> prEntry : vecHeap) {
+	vecNearest.push_back(prEntry.second);
+      }
+    }
+    
+    return vecNearest;
+  }
+  
+  std::vector<unsigned int> KDTree::radius(Eigen::VectorXf vxQuery, float fRadius) {
+    std::vector<unsigned int> vecResult;
+    
+    if(m_vecNodes.size() > 0) {
+      this->collect(0, vxQuery, fRadius * fRadius, vecResult);
+    }
+    
+    return vecResult;
+  }
+  
+  void KDTree::filter(int nNode, const Eigen::MatrixXf& mxCentroids, std::vector<unsigned int> vecCandidates, Eigen::MatrixXd& mxSums, std::vector<unsigned int>& vecCounts, std::vector<unsigned int>& vecLabels) {
+    Node& ndNode = m_vecNodes[nNode];
+    
+    if(ndNode.nLeft < 0) {
+      Dataset::MatrixMap mxData = m_dsData->matrix();
+      
+      for(unsigned int unI = ndNode.unBegin; unI < ndNode.unEnd; ++unI) {
+	unsigned int unSample = m_vecIndices[unI];
+	unsigned int unClosest = vecCandidates[0];
+	float fSmallestDistance = (mxCentroids.col(unClosest) - mxData.col(unSample)).squaredNorm();
+	
+	for(unsigned int unC = 1; unC < vecCandidates.size(); ++unC) {
+	  float fDistance = (mxCentroids.col(vecCandidates[unC]) - mxData.col(unSample)).squaredNorm();
+	  
+	  if(fDistance < fSmallestDistance) {
+	    unClosest = vecCandidates[unC];
+	    fSmallestDistance = fDistance;
+	  }
+	}
+	
+	vecLabels[unSample] = unClosest;
+	mxSums.col(unClosest) += mxData.col(unSample).cast<double>();
+	vecCounts[unClosest]++;
+      }
+      
+      return;
+    }
+    
+    // The candidate closest to the box center wins the box unless
+    // another one is closer to the box corner furthest in its own
+    // direction.
+    Eigen::VectorXf vxCenter = (ndNode.vxMin + ndNode.vxMax) / 2;
+    unsigned int unBest = vecCandidates[0];
+    float fSmallestDistance = (mxCentroids.col(unBest) - vxCenter).squaredNorm();
+    
+    for(unsigned int unC = 1; unC < vecCandidates.size(); ++unC) {
+      float fDistance = (mxCentroids.col(vecCandidates[unC]) - vxCenter).squaredNorm();
+      
+      if(fDistance < fSmallestDistance) {
+	unBest = vecCandidates[unC];
+	fSmallestDistance = fDistance;
+      }
+    }
+    
+    std::vector<unsigned int> vecKept;
+    for(unsigned int unCandidate : vecCandidates) {
+      if(unCandidate == unBest) {
+	vecKept.push_back(unCandidate);
+      } else {
+	Eigen::VectorXf vxCorner = (mxCentroids.col(unCandidate).array() > mxCentroids.col(unBest).array()).select(ndNode.vxMax, ndNode.vxMin);
+	
+	if((mxCentroids.col(unCandidate) - vxCorner).squaredNorm() <= (mxCentroids.col(unBest) - vxCorner).squaredNorm()) {
+	  vecKept.push_back(unCandidate);
+	}
+      }
+    }
+    
+    if(vecKept.size() == 1) {
+      for(unsigned int unI = ndNode.unBegin; unI < ndNode.unEnd; ++unI) {
+	vecLabels[m_vecIndices[unI]] = unBest;
+      }
+      
+      mxSums.col(unBest) += ndNode.vxSum;
+      vecCounts[unBest] += ndNode.unEnd - ndNode.unBegin;
+    } else {
+      this->filter(ndNode.nLeft, mxCentroids, vecKept, mxSums, vecCounts, vecLabels);
+      this->filter(ndNode.nRight, mxCentroids, vecKept, mxSums, vecCounts, vecLabels);
+    }
+  }
+  
+  void KDTree::assign(const Eigen::MatrixXf& mxCentroids, Eigen::MatrixXd& mxSums, std::vector<unsigned int>& vecCounts, std::vector<unsigned int>& vecLabels) {
+    unsigned int unClusters = mxCentroids.cols();
+    
+    mxSums.setZero(mxCentroids.rows(), unClusters);
+    vecCounts.assign(unClusters, 0);
+    vecLabels.resize(m_dsData->count());
+    
+    if(m_vecNodes.size() > 0 && unClusters > 0) {
+      std::vector<unsigned int> vecCandidates(unClusters);
+      for(unsigned int unCentroid = 0; unCentroid < unClusters; ++unCentroid) {
+	vecCandidates[unCentroid] = unCentroid;
+      }
+      
+      this->filter(0, mxCentroids, vecCandidates, mxSums, vecCounts, vecLabels);
+    }
+  }
+}
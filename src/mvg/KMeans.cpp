@@ -1,8 +1,18 @@
 #include <mvg/KMeans.h>
 
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include <mvg/Parallel.h>
+
 
 namespace mvg {
-  KMeans::KMeans() : m_dsSource(nullptr) {
+  KMeans::KMeans() : m_dsSource(nullptr), m_bClustersCollected(true), m_algAlgorithm(Lloyd), m_sdSeeding(KMeansPlusPlus), m_bFixedSeed(false), m_ulSeed(0), m_unBatchSize(1024), m_unMaxBatches(100), m_dBatchTolerance(1e-3), m_slSilhouette(Exact), m_unSilhouetteSamples(2000), m_ulSilhouetteSeed(0), m_unRestarts(1), m_dTolerance(1e-4) {
+    m_clClustering.unIterations = 0;
+    m_clClustering.dInertia = 0.0;
+    m_clClustering.unRestart = 0;
   }
   
   KMeans::~KMeans() {
@@ -12,28 +22,76 @@ namespace mvg {
     m_dsSource = dsSource;
   }
   
-  bool KMeans::calculate(unsigned int unMinClusters, unsigned int unMaxClusters) {
-    unsigned int unDimension = m_dsSource->dimension();
+  void KMeans::setAlgorithm(Algorithm algAlgorithm) {
+    m_algAlgorithm = algAlgorithm;
+  }
+  
+  void KMeans::setSeeding(Seeding sdSeeding) {
+    m_sdSeeding = sdSeeding;
+  }
+  
+  void KMeans::setSeed(unsigned long ulSeed) {
+    m_bFixedSeed = true;
+    m_ulSeed = ulSeed;
+  }
+  
+  void KMeans::setMiniBatch(unsigned int unBatchSize, unsigned int unMaxBatches, double dTolerance) {
+    m_unBatchSize = std::max(unBatchSize, 1u);
+    m_unMaxBatches = unMaxBatches;
+    m_dBatchTolerance = dTolerance;
+  }
+  
+  void KMeans::setTolerance(double dTolerance) {
+    m_dTolerance = dTolerance;
+  }
+  
+  void KMeans::setRestarts(unsigned int unRestarts) {
+    m_unRestarts = std::max(unRestarts, 1u);
+  }
+  
+  void KMeans::setSilhouette(Silhouette slSilhouette, unsigned int unSamples, unsigned long ulSeed) {
+    m_slSilhouette = slSilhouette;
+    m_unSilhouetteSamples = std::max(unSamples, 1u);
+    m_ulSilhouetteSeed = ulSeed;
+  }
+  
+  bool KMeans::calculate(unsigned int unMinClusters, unsigned int unMaxClusters, Criterion crCriterion) {
+    if(!m_dsSource || unMaxClusters < unMinClusters) {
+      return false;
+    }
+    
+    // Every cluster count is clustered and scored concurrently on its
+    // own copy of this instance; the best-scoring copy is then taken
+    // over as it is.
+    unsigned int unCandidates = unMaxClusters - unMinClusters + 1;
+    std::vector<KMeans> vecCandidates(unCandidates, *this);
+    std::vector<double> vecScores(unCandidates, -1);
     
+    Parallel::forRange(unCandidates, 1, [&](unsigned int unBegin, unsigned int unEnd) {
+	for(unsigned int unCandidate = unBegin; unCandidate < unEnd; ++unCandidate) {
+	  vecScores[unCandidate] = vecCandidates[unCandidate].score(crCriterion, unMinClusters + unCandidate);
+	}
+      });
+    
+    unsigned int unBestCandidate = 0;
     unsigned int unBestClusterCount = 0;
-    double dLowestAverageSilhouetteValue = -1;
+    double dBestScore = -1;
     
-    for(unsigned int unClusters = unMinClusters; unClusters <= unMaxClusters; ++unClusters) {
-      double dAverageSilhouetteValue = this->silhouetteAverage(unClusters);
-      
-      if(dLowestAverageSilhouetteValue == -1 || dAverageSilhouetteValue > dLowestAverageSilhouetteValue) {
-	unBestClusterCount = unClusters;
-	dLowestAverageSilhouetteValue = dAverageSilhouetteValue;
+    for(unsigned int unCandidate = 0; unCandidate < unCandidates; ++unCandidate) {
+      if(unCandidate == 0 || vecScores[unCandidate] > dBestScore) {
+	unBestCandidate = unCandidate;
+	unBestClusterCount = unMinClusters + unCandidate;
+	dBestScore = vecScores[unCandidate];
       }
     }
     
-    this->calculate(unBestClusterCount);
+    *this = vecCandidates[unBestCandidate];
     
     // Throw out any outliers
     unsigned int unMinSamples = m_dsSource->count() / (2.5 * unBestClusterCount);
     std::vector<Dataset::Ptr> vecFilteredClusters;
     
-    for(Dataset::Ptr dsCluster : m_vecClusters) {
+    for(Dataset::Ptr dsCluster : this->clusters()) {
       if(dsCluster->count() >= unMinSamples) {
 	vecFilteredClusters.push_back(dsCluster);
       }
@@ -41,7 +99,7 @@ namespace mvg {
     
     m_vecClusters = vecFilteredClusters;
     
-    return m_vecClusters.size() > 0 && (dLowestAverageSilhouetteValue > -1);
+    return m_vecClusters.size() > 0 && (crCriterion != AverageSilhouette || dBestScore > -1);
   }
   
   bool KMeans::calculate(unsigned int unClusters) {
@@ -57,127 +115,59 @@ namespace mvg {
 	    unClusters = unSamples;
 	  }
 	  
-	  srand(time(NULL));
-	  
-	  std::vector<Eigen::VectorXf> vecCentroids;
-	  
-	  // Initialize centroids (first entries in the sample list)
-	  std::vector<unsigned int> vecSampleIndices;
-	  while(vecCentroids.size() < unClusters) {
-	    vecCentroids.push_back((*m_dsSource)[vecCentroids.size()]);
-	  }
-	  
-	  unsigned int unIterations = 0;
-	  unsigned int unMaxIterations = 1000;
-	  std::vector<Eigen::VectorXf> vecOldCentroids;
+	  unsigned long ulSeed = (m_bFixedSeed ? m_ulSeed : std::random_device()());
 	  
-	  std::map<unsigned int, unsigned int> mapAssignments;
-	  
-	  bool bFirstRun = true;
-	  bool bGoon = true;
-	  while(bGoon) {
-	    if(!bFirstRun) {
-	      if(unIterations <= unMaxIterations) {
-		bool bAllEqual = true;
-		
-		for(unsigned int unCentroid = 0; unCentroid < vecCentroids.size(); ++unCentroid) {
-		  double dTolerance = 1e-4;
-		  
-		  if((vecCentroids[unCentroid] - vecOldCentroids[unCentroid]).norm() > dTolerance) {
-		    bAllEqual = false;
-		    break;
-		  }
-		}
-		
-		bGoon = !bAllEqual;
-	      } else {
-		bGoon = false;
-	      }
-	    } else {
-	      bFirstRun = false;
-	    }
+	  if(m_unRestarts <= 1) {
+	    m_mtEngine.seed(ulSeed);
+	    m_clClustering = this->run(unClusters);
+	  } else {
+	    // Every restart works on its own (lightweight) copy
+	    m_clClustering.vecLabels.clear();
+	    m_vecClusters.clear();
 	    
-	    if(bGoon) {
-	      vecOldCentroids = vecCentroids;
-	      unIterations++;
-	      
-	      // "Assign labels"
-	      for(unsigned int unSample = 0; unSample < unSamples; ++unSample) {
-		unsigned int unClosestCentroid = 0;
-		double dSmallestDistance = -1;
-		
-		for(unsigned int unCentroid = 0; unCentroid < vecCentroids.size(); ++unCentroid) {
-		  double dDistance = ((*m_dsSource)[unSample] - vecCentroids[unCentroid]).norm();
-		  
-		  if(dSmallestDistance == -1 || dDistance < dSmallestDistance) {
-		    unClosestCentroid = unCentroid;
-		    dSmallestDistance = dDistance;
-		  }
-		}
-		
-		mapAssignments[unSample] = unClosestCentroid;
-	      }
-	      
-	      // Check if all clusters have samples
-	      bool bClustersGood = true;
-	      for(unsigned int unCentroid = 0; unCentroid < vecCentroids.size(); ++unCentroid) {
-		bool bFound = false;
-		
-		for(std::pair<unsigned int, unsigned int> prAssignment : mapAssignments) {
-		  if(prAssignment.second == unCentroid) {
-		    bFound = true;
-		    break;
-		  }
-		}
-		
-		if(!bFound) {
-		  bClustersGood = false;
-		  break;
-		}
-	      }
-	      
-	      if(!bClustersGood) {
-		// Randomly re-initialize
-		vecCentroids.clear();
-		
-		std::vector<unsigned int> vecSampleIndices;
-		while(vecSampleIndices.size() < unClusters) {
-		  unsigned int unSampleIndex = (rand() % unSamples);
-		  
-		  if(std::find(vecSampleIndices.begin(), vecSampleIndices.end(), unSampleIndex) == vecSampleIndices.end()) {
-		    vecSampleIndices.push_back(unSampleIndex);
-		  }
-		}
-		
-		for(unsigned int unSampleIndex : vecSampleIndices) {
-		  vecCentroids.push_back((*m_dsSource)[unSampleIndex]);
-		}
-	      } else {
-		// Move means
-		for(unsigned int unCentroid = 0; unCentroid < vecCentroids.size(); ++unCentroid) {
-		  Eigen::VectorXf evcMean = Eigen::VectorXf::Zero(unDimensions);
-		  unsigned int unCount = 0;
+	    std::vector<Clustering> vecRuns(m_unRestarts);
+	    Parallel::forRange(m_unRestarts, 1, [&](unsigned int unBegin, unsigned int unEnd) {
+		for(unsigned int unRestart = unBegin; unRestart < unEnd; ++unRestart) {
+		  KMeans kmRestart(*this);
 		  
-		  for(std::pair<unsigned int, unsigned int> prAssignment : mapAssignments) {
-		    if(prAssignment.second == unCentroid) {
-		      evcMean += (*m_dsSource)[prAssignment.first];
-		      unCount++;
-		    }
+		  if(unRestart == 0) {
+		    kmRestart.m_mtEngine.seed(ulSeed);
+		  } else {
+		    std::seed_seq sqSeed{(unsigned int)ulSeed, unRestart};
+		    kmRestart.m_mtEngine.seed(sqSeed);
 		  }
 		  
-		  vecCentroids[unCentroid] = evcMean / unCount;
+		  vecRuns[unRestart] = kmRestart.run(unClusters);
 		}
+	      });
+	    
+	    unsigned int unBest = 0;
+	    std::vector<unsigned int> vecIterations;
+	    std::vector<double> vecInertias;
+	    
+	    for(unsigned int unRestart = 0; unRestart < m_unRestarts; ++unRestart) {
+	      vecIterations.push_back(vecRuns[unRestart].unIterations);
+	      vecInertias.push_back(vecRuns[unRestart].dInertia);
+	      
+	      if(vecRuns[unRestart].dInertia < vecRuns[unBest].dInertia) {
+		unBest = unRestart;
 	      }
 	    }
+	    
+	    m_clClustering = vecRuns[unBest];
+	    m_clClustering.unRestart = unBest;
+	    m_clClustering.vecRestartIterations = vecIterations;
+	    m_clClustering.vecRestartInertias = vecInertias;
 	  }
 	  
+	  // The per-cluster datasets are only copied out when asked for
 	  m_vecClusters.clear();
-	  for(unsigned int unI = 0; unI < unClusters; unI++) {
-	    m_vecClusters.push_back(Dataset::create());
-	  }
+	  m_bClustersCollected = false;
 	  
-	  for(std::pair<unsigned int, unsigned int> prAssignment : mapAssignments) {
-	    m_vecClusters[prAssignment.second]->add((*m_dsSource)[prAssignment.first]);
+	  // Lets `partialFit()` continue from this result
+	  m_vecCentroidCounts.assign(m_clClustering.mxCentroids.cols(), 0.0);
+	  for(unsigned int unLabel : m_clClustering.vecLabels) {
+	    m_vecCentroidCounts[unLabel]++;
 	  }
 	  
 	  return true;
@@ -188,15 +178,634 @@ namespace mvg {
     return false;
   }
   
+  unsigned int KMeans::drawWeighted(std::vector<double>& vecWeights, double dTotal) {
+    // Index drawn with a probability proportional to its weight; if
+    // all weights are zero, uniformly.
+    if(!(dTotal > 0) || !std::isfinite(dTotal)) {
+      return std::uniform_int_distribution<unsigned int>(0, vecWeights.size() - 1)(m_mtEngine);
+    }
+    
+    double dTarget = std::uniform_real_distribution<double>(0.0, dTotal)(m_mtEngine);
+    unsigned int unLastPositive = 0;
+    
+    for(unsigned int unI = 0; unI < vecWeights.size(); ++unI) {
+      if(vecWeights[unI] > 0) {
+	dTarget -= vecWeights[unI];
+	unLastPositive = unI;
+	
+	if(dTarget < 0) {
+	  return unI;
+	}
+      }
+    }
+    
+    // Only reached through rounding
+    return unLastPositive;
+  }
+  
+  void KMeans::updateDistances(Dataset::Ptr dsData, Eigen::VectorXf vxCentroid, std::vector<double>& vecDistances, double& dTotal) {
+    // Lowers the squared distance of every sample to its nearest
+    // centroid so far, given one more centroid.
+    Dataset::MatrixMap mxData = dsData->matrix();
+    dTotal = 0.0;
+    
+    for(unsigned int unSample = 0; unSample < vecDistances.size(); ++unSample) {
+      vecDistances[unSample] = std::min(vecDistances[unSample], (double)(mxData.col(unSample) - vxCentroid).squaredNorm());
+      dTotal += vecDistances[unSample];
+    }
+  }
+  
+  Eigen::MatrixXf KMeans::seedPlusPlus(Dataset::Ptr dsData, unsigned int unClusters) {
+    // k-means++: the first centroid is a uniformly drawn sample, every
+    // further one a sample drawn with a probability proportional to its
+    // squared distance to the closest centroid so far.
+    Dataset::MatrixMap mxData = dsData->matrix();
+    Eigen::MatrixXf mxCentroids(mxData.rows(), unClusters);
+    std::vector<double> vecDistances(mxData.cols(), std::numeric_limits<double>::infinity());
+    double dTotal = 0.0;
+    
+    for(unsigned int unCentroid = 0; unCentroid < unClusters; ++unCentroid) {
+      mxCentroids.col(unCentroid) = mxData.col(this->drawWeighted(vecDistances, dTotal));
+      this->updateDistances(dsData, mxCentroids.col(unCentroid), vecDistances, dTotal);
+    }
+    
+    return mxCentroids;
+  }
+  
+  Eigen::MatrixXf KMeans::seedParallel(Dataset::Ptr dsData, unsigned int unClusters) {
+    // k-means|| (Bahmani et al.): starting from one uniformly drawn
+    // sample, every round draws each sample independently with a
+    // probability of `l * D^2 / sum(D^2)` (l = 2k). The few dozen
+    // candidates gathered that way are weighted by the number of
+    // samples closest to them and reduced to k centroids by weighted
+    // k-means++. The distance updates of a round run in parallel.
+    const unsigned int unRounds = 5;
+    double dOversampling = 2.0 * unClusters;
+    
+    Dataset::MatrixMap mxData = dsData->matrix();
+    unsigned int unSamples = mxData.cols();
+    std::vector<double> vecDistances(unSamples, std::numeric_limits<double>::infinity());
+    std::vector<unsigned int> vecNearest(unSamples, 0);
+    std::vector<unsigned int> vecCandidates;
+    std::vector<unsigned int> vecNewCandidates = {std::uniform_int_distribution<unsigned int>(0, unSamples - 1)(m_mtEngine)};
+    std::uniform_real_distribution<double> urdUnit(0.0, 1.0);
+    
+    for(unsigned int unRound = 0; unRound <= unRounds && vecNewCandidates.size() > 0; ++unRound) {
+      unsigned int unFirstNew = vecCandidates.size();
+      vecCandidates.insert(vecCandidates.end(), vecNewCandidates.begin(), vecNewCandidates.end());
+      
+      Parallel::forRange(unSamples, 4096, [&](unsigned int unBegin, unsigned int unEnd) {
+	  for(unsigned int unSample = unBegin; unSample < unEnd; ++unSample) {
+	    for(unsigned int unCandidate = unFirstNew; unCandidate < vecCandidates.size(); ++unCandidate) {
+	      double dDistance = (mxData.col(unSample) - mxData.col(vecCandidates[unCandidate])).squaredNorm();
+	      
+	      if(dDistance < vecDistances[unSample]) {
+		vecDistances[unSample] = dDistance;
+		vecNearest[unSample] = unCandidate;
+	      }
+	    }
+	  }
+	});
+      
+      double dTotal = 0.0;
+      for(double dDistance : vecDistances) {
+	dTotal += dDistance;
+      }
+      
+      vecNewCandidates.clear();
+      if(unRound < unRounds && dTotal > 0) {
+	for(unsigned int unSample = 0; unSample < unSamples; ++unSample) {
+	  if(urdUnit(m_mtEngine) < dOversampling * vecDistances[unSample] / dTotal) {
+	    vecNewCandidates.push_back(unSample);
+	  }
+	}
+      }
+    }
+    
+    if(vecCandidates.size() <= unClusters) {
+      // Too few distinct samples to choose from; continue with plain
+      // k-means++ draws.
+      Eigen::MatrixXf mxCentroids(mxData.rows(), unClusters);
+      double dTotal = 0.0;
+      
+      for(unsigned int unCentroid = 0; unCentroid < unClusters; ++unCentroid) {
+	if(unCentroid < vecCandidates.size()) {
+	  mxCentroids.col(unCentroid) = mxData.col(vecCandidates[unCentroid]);
+	} else {
+	  mxCentroids.col(unCentroid) = mxData.col(this->drawWeighted(vecDistances, dTotal));
+	}
+	
+	this->updateDistances(dsData, mxCentroids.col(unCentroid), vecDistances, dTotal);
+      }
+      
+      return mxCentroids;
+    }
+    
+    std::vector<double> vecWeights(vecCandidates.size(), 0.0);
+    for(unsigned int unCandidate : vecNearest) {
+      vecWeights[unCandidate] += 1.0;
+    }
+    
+    // Weighted k-means++ on the candidates
+    Eigen::MatrixXf mxCentroids(mxData.rows(), unClusters);
+    std::vector<double> vecCandidateDistances(vecCandidates.size(), std::numeric_limits<double>::infinity());
+    std::vector<double> vecScores = vecWeights;
+    double dScoreTotal = unSamples;
+    
+    for(unsigned int unCentroid = 0; unCentroid < unClusters; ++unCentroid) {
+      mxCentroids.col(unCentroid) = mxData.col(vecCandidates[this->drawWeighted(vecScores, dScoreTotal)]);
+      dScoreTotal = 0.0;
+      
+      for(unsigned int unCandidate = 0; unCandidate < vecCandidates.size(); ++unCandidate) {
+	double dDistance = (mxData.col(vecCandidates[unCandidate]) - mxCentroids.col(unCentroid)).squaredNorm();
+	
+	vecCandidateDistances[unCandidate] = std::min(vecCandidateDistances[unCandidate], dDistance);
+	vecScores[unCandidate] = vecWeights[unCandidate] * vecCandidateDistances[unCandidate];
+	dScoreTotal += vecScores[unCandidate];
+      }
+    }
+    
+    return mxCentroids;
+  }
+  
+  Eigen::MatrixXf KMeans::seed(Dataset::Ptr dsData, unsigned int unClusters) {
+    switch(m_sdSeeding) {
+    case KMeansPlusPlus:
+      return this->seedPlusPlus(dsData, unClusters);
+    
+    case KMeansParallel:
+      return this->seedParallel(dsData, unClusters);
+    
+    default:
+      // First entries in the sample list
+      return dsData->matrix().leftCols(unClusters);
+    }
+  }
+  
+  void KMeans::reseed(Eigen::MatrixXf& mxCentroids) {
+    // Randomly re-initialize from distinct samples
+    Dataset::MatrixMap mxData = m_dsSource->matrix();
+    unsigned int unSamples = mxData.cols();
+    std::uniform_int_distribution<unsigned int> uidSample(0, unSamples - 1);
+    
+    std::vector<unsigned int> vecSampleIndices;
+    while(vecSampleIndices.size() < (size_t)mxCentroids.cols()) {
+      unsigned int unSampleIndex = uidSample(m_mtEngine);
+      
+      if(std::find(vecSampleIndices.begin(), vecSampleIndices.end(), unSampleIndex) == vecSampleIndices.end()) {
+	vecSampleIndices.push_back(unSampleIndex);
+      }
+    }
+    
+    for(unsigned int unCentroid = 0; unCentroid < vecSampleIndices.size(); ++unCentroid) {
+      mxCentroids.col(unCentroid) = mxData.col(vecSampleIndices[unCentroid]);
+    }
+  }
+  
+  bool KMeans::moveMeans(Eigen::MatrixXd& mxSums, std::vector<unsigned int>& vecCounts, Eigen::MatrixXf& mxCentroids, Eigen::VectorXd& vxMovement) {
+    // Moves every centroid to the mean of its samples; returns whether
+    // any of them moved by more than the tolerance.
+    bool bMoved = false;
+    
+    vxMovement.resize(mxCentroids.cols());
+    
+    for(unsigned int unCentroid = 0; unCentroid < mxCentroids.cols(); ++unCentroid) {
+      Eigen::VectorXf vxMean = (mxSums.col(unCentroid) / (double)vecCounts[unCentroid]).cast<float>();
+      
+      vxMovement[unCentroid] = (vxMean - mxCentroids.col(unCentroid)).norm();
+      if(vxMovement[unCentroid] > m_dTolerance) {
+	bMoved = true;
+      }
+      
+      mxCentroids.col(unCentroid) = vxMean;
+    }
+    
+    return bMoved;
+  }
+  
+  double KMeans::inertia(Clustering& clClustering) {
+    Dataset::MatrixMap mxData = m_dsSource->matrix();
+    double dInertia = 0.0;
+    
+    for(unsigned int unSample = 0; unSample < clClustering.vecLabels.size(); ++unSample) {
+      dInertia += (mxData.col(unSample) - clClustering.mxCentroids.col(clClustering.vecLabels[unSample])).squaredNorm();
+    }
+    
+    return dInertia;
+  }
+  
+  KMeans::Clustering KMeans::lloyd(Eigen::MatrixXf mxCentroids) {
+    // Lloyd's iteration on a flat label array. Assigning labels also
+    // accumulates the per-cluster sums and counts, so moving the means
+    // needs no further pass over the samples. Distances are compared
+    // squared.
+    const unsigned int unMaxIterations = 1000;
+    
+    Dataset::MatrixMap mxData = m_dsSource->matrix();
+    unsigned int unSamples = mxData.cols();
+    unsigned int unClusters = mxCentroids.cols();
+    
+    Clustering clResult;
+    clResult.vecLabels.resize(unSamples, 0);
+    clResult.unIterations = 0;
+    
+    Eigen::MatrixXd mxSums(mxData.rows(), unClusters);
+    std::vector<unsigned int> vecCounts(unClusters);
+    Eigen::VectorXd vxMovement;
+    
+    bool bGoon = true;
+    while(bGoon && clResult.unIterations <= unMaxIterations) {
+      clResult.unIterations++;
+      mxSums.setZero();
+      std::fill(vecCounts.begin(), vecCounts.end(), 0);
+      
+      // "Assign labels"
+      for(unsigned int unSample = 0; unSample < unSamples; ++unSample) {
+	Eigen::MatrixXf::Index nClosestCentroid;
+	(mxCentroids.colwise() - mxData.col(unSample)).colwise().squaredNorm().minCoeff(&nClosestCentroid);
+	
+	clResult.vecLabels[unSample] = nClosestCentroid;
+	mxSums.col(nClosestCentroid) += mxData.col(unSample).cast<double>();
+	vecCounts[nClosestCentroid]++;
+      }
+      
+      if(std::find(vecCounts.begin(), vecCounts.end(), 0) != vecCounts.end()) {
+	// Not all clusters have samples
+	this->reseed(mxCentroids);
+      } else {
+	bGoon = this->moveMeans(mxSums, vecCounts, mxCentroids, vxMovement);
+      }
+    }
+    
+    clResult.mxCentroids = mxCentroids;
+    clResult.dInertia = this->inertia(clResult);
+    
+    return clResult;
+  }
+  
+  KMeans::Clustering KMeans::hamerly(Eigen::MatrixXf mxCentroids) {
+    // Hamerly's variant of Lloyd's iteration. Every sample keeps an
+    // upper bound on the distance to its own centroid and a lower bound
+    // on the distance to any other one; when the centroids move, the
+    // bounds are loosened by how far they moved. A sample whose upper
+    // bound is below its lower bound and below half the distance from
+    // its centroid to the nearest other centroid keeps its label
+    // without computing any distance. The bounds are checked with a
+    // small relative margin, and labels are otherwise chosen exactly
+    // like in `lloyd()`, so both produce the same clusters.
+    const unsigned int unMaxIterations = 1000;
+    const double dMargin = 1e-5;
+    
+    Dataset::MatrixMap mxData = m_dsSource->matrix();
+    unsigned int unSamples = mxData.cols();
+    unsigned int unClusters = mxCentroids.cols();
+    
+    Clustering clResult;
+    clResult.vecLabels.resize(unSamples, 0);
+    clResult.unIterations = 0;
+    
+    Eigen::MatrixXd mxSums(mxData.rows(), unClusters);
+    std::vector<unsigned int> vecCounts(unClusters);
+    Eigen::VectorXd vxMovement;
+    
+    std::vector<double> vecUpper(unSamples);
+    std::vector<double> vecLower(unSamples);
+    Eigen::VectorXd vxHalfGap(unClusters);
+    Eigen::RowVectorXf rvxDistances(unClusters);
+    double dLargestMovement = 0.0;
+    bool bFullScan = true;
+    
+    bool bGoon = true;
+    while(bGoon && clResult.unIterations <= unMaxIterations) {
+      clResult.unIterations++;
+      
+      if(!bFullScan) {
+	for(unsigned int unCentroid = 0; unCentroid < unClusters; ++unCentroid) {
+	  vxHalfGap[unCentroid] = std::numeric_limits<double>::infinity();
+	  
+	  for(unsigned int unOther = 0; unOther < unClusters; ++unOther) {
+	    if(unOther != unCentroid) {
+	      vxHalfGap[unCentroid] = std::min(vxHalfGap[unCentroid], 0.5 * (mxCentroids.col(unCentroid) - mxCentroids.col(unOther)).norm());
+	    }
+	  }
+	}
+      }
+      
+      mxSums.setZero();
+      std::fill(vecCounts.begin(), vecCounts.end(), 0);
+      
+      // "Assign labels"; sums are accumulated in sample order, so the
+      // means equal those of `lloyd()`
+      for(unsigned int unSample = 0; unSample < unSamples; ++unSample) {
+	if(!bFullScan) {
+	  unsigned int unLabel = clResult.vecLabels[unSample];
+	  
+	  // Loosen the bounds by the last movement of the centroids
+	  vecUpper[unSample] += vxMovement[unLabel];
+	  vecLower[unSample] -= dLargestMovement;
+	  
+	  double dBound = (1 - dMargin) * std::max(vxHalfGap[unLabel], vecLower[unSample]);
+	  bool bKeep = (vecUpper[unSample] < dBound);
+	  
+	  if(!bKeep) {
+	    vecUpper[unSample] = (mxData.col(unSample) - mxCentroids.col(unLabel)).norm();
+	    bKeep = (vecUpper[unSample] < dBound);
+	  }
+	  
+	  if(bKeep) {
+	    mxSums.col(unLabel) += mxData.col(unSample).cast<double>();
+	    vecCounts[unLabel]++;
+	    continue;
+	  }
+	}
+	
+	Eigen::MatrixXf::Index nClosestCentroid;
+	rvxDistances.noalias() = (mxCentroids.colwise() - mxData.col(unSample)).colwise().squaredNorm();
+	float fSmallestDistance = rvxDistances.minCoeff(&nClosestCentroid);
+	float fSecondDistance = std::numeric_limits<float>::infinity();
+	
+	for(unsigned int unCentroid = 0; unCentroid < unClusters; ++unCentroid) {
+	  if(unCentroid != nClosestCentroid) {
+	    fSecondDistance = std::min(fSecondDistance, rvxDistances[unCentroid]);
+	  }
+	}
+	
+	clResult.vecLabels[unSample] = nClosestCentroid;
+	vecUpper[unSample] = sqrt(fSmallestDistance);
+	vecLower[unSample] = sqrt(fSecondDistance);
+	mxSums.col(nClosestCentroid) += mxData.col(unSample).cast<double>();
+	vecCounts[nClosestCentroid]++;
+      }
+      
+      bFullScan = false;
+      
+      if(std::find(vecCounts.begin(), vecCounts.end(), 0) != vecCounts.end()) {
+	// Not all clusters have samples
+	this->reseed(mxCentroids);
+	bFullScan = true;
+      } else {
+	bGoon = this->moveMeans(mxSums, vecCounts, mxCentroids, vxMovement);
+	dLargestMovement = vxMovement.maxCoeff();
+      }
+    }
+    
+    clResult.mxCentroids = mxCentroids;
+    clResult.dInertia = this->inertia(clResult);
+    
+    return clResult;
+  }
+  
+  KMeans::Clustering KMeans::run(unsigned int unClusters) {
+    // One run from seeding to convergence, drawing from `m_mtEngine`
+    Eigen::MatrixXf mxCentroids = this->seed(m_dsSource, unClusters);
+    Clustering clResult;
+    
+    if(m_algAlgorithm == Hamerly) {
+      clResult = this->hamerly(mxCentroids);
+    } else if(m_algAlgorithm == MiniBatch) {
+      clResult = this->miniBatch(mxCentroids);
+    } else if(m_algAlgorithm == Filtering) {
+      clResult = this->filtering(mxCentroids);
+    } else {
+      clResult = this->lloyd(mxCentroids);
+    }
+    
+    clResult.unRestart = 0;
+    clResult.vecRestartIterations = {clResult.unIterations};
+    clResult.vecRestartInertias = {clResult.dInertia};
+    
+    return clResult;
+  }
+  
+  KMeans::Clustering KMeans::filtering(Eigen::MatrixXf mxCentroids) {
+    // Lloyd's iteration with the assignment step of a k-d tree, built
+    // once per run
+    const unsigned int unMaxIterations = 1000;
+    
+    KDTree kdtTree(m_dsSource);
+    unsigned int unClusters = mxCentroids.cols();
+    
+    Clustering clResult;
+    clResult.unIterations = 0;
+    
+    Eigen::MatrixXd mxSums;
+    std::vector<unsigned int> vecCounts(unClusters);
+    Eigen::VectorXd vxMovement;
+    
+    bool bGoon = true;
+    while(bGoon && clResult.unIterations <= unMaxIterations) {
+      clResult.unIterations++;
+      kdtTree.assign(mxCentroids, mxSums, vecCounts, clResult.vecLabels);
+      
+      if(std::find(vecCounts.begin(), vecCounts.end(), 0) != vecCounts.end()) {
+	// Not all clusters have samples
+	this->reseed(mxCentroids);
+      } else {
+	bGoon = this->moveMeans(mxSums, vecCounts, mxCentroids, vxMovement);
+      }
+    }
+    
+    clResult.mxCentroids = mxCentroids;
+    clResult.dInertia = this->inertia(clResult);
+    
+    return clResult;
+  }
+  
+  double KMeans::miniBatchStep(const Eigen::Ref<const Eigen::MatrixXf>& mxBatch, Eigen::MatrixXf& mxCentroids) {
+    // One mini-batch update (Sculley): every centroid moves to the mean
+    // of all samples ever assigned to it, that is towards the mean of
+    // its batch samples by a per-centroid learning rate of `batch count
+    // / total count`. Returns the inertia of the batch against the
+    // centroids before the update.
+    unsigned int unClusters = mxCentroids.cols();
+    Eigen::MatrixXd mxSums = Eigen::MatrixXd::Zero(mxBatch.rows(), unClusters);
+    std::vector<unsigned int> vecCounts(unClusters, 0);
+    double dInertia = 0.0;
+    
+    for(unsigned int unSample = 0; unSample < mxBatch.cols(); ++unSample) {
+      Eigen::MatrixXf::Index nClosestCentroid;
+      dInertia += (mxCentroids.colwise() - mxBatch.col(unSample)).colwise().squaredNorm().minCoeff(&nClosestCentroid);
+      
+      mxSums.col(nClosestCentroid) += mxBatch.col(unSample).cast<double>();
+      vecCounts[nClosestCentroid]++;
+    }
+    
+    for(unsigned int unCentroid = 0; unCentroid < unClusters; ++unCentroid) {
+      if(vecCounts[unCentroid] > 0) {
+	m_vecCentroidCounts[unCentroid] += vecCounts[unCentroid];
+	double dRate = vecCounts[unCentroid] / m_vecCentroidCounts[unCentroid];
+	
+	mxCentroids.col(unCentroid) += (dRate * (mxSums.col(unCentroid) / vecCounts[unCentroid] - mxCentroids.col(unCentroid).cast<double>())).cast<float>();
+      } else if(m_vecCentroidCounts[unCentroid] == 0) {
+	// Never had a sample; retry from a random one of this batch
+	mxCentroids.col(unCentroid) = mxBatch.col(std::uniform_int_distribution<unsigned int>(0, mxBatch.cols() - 1)(m_mtEngine));
+      }
+    }
+    
+    return dInertia;
+  }
+  
+  KMeans::Clustering KMeans::miniBatch(Eigen::MatrixXf mxCentroids) {
+    // Draws batches (with replacement) until the exponentially smoothed
+    // per-sample batch inertia stopped improving for a while or the
+    // batch budget is used up. Only the final labelling looks at every
+    // sample.
+    const unsigned int unPatience = 10;
+    
+    Dataset::MatrixMap mxData = m_dsSource->matrix();
+    unsigned int unSamples = mxData.cols();
+    unsigned int unBatchSize = std::min(m_unBatchSize, unSamples);
+    double dSmoothing = std::min(1.0, 2.0 * unBatchSize / (unSamples + 1));
+    std::uniform_int_distribution<unsigned int> uidSample(0, unSamples - 1);
+    
+    Clustering clResult;
+    clResult.unIterations = 0;
+    m_vecCentroidCounts.assign(mxCentroids.cols(), 0.0);
+    
+    Eigen::MatrixXf mxBatch(mxData.rows(), unBatchSize);
+    double dSmoothedInertia = 0.0;
+    double dBestInertia = std::numeric_limits<double>::infinity();
+    unsigned int unStale = 0;
+    
+    while(clResult.unIterations < m_unMaxBatches && unStale < unPatience) {
+      for(unsigned int unSample = 0; unSample < unBatchSize; ++unSample) {
+	mxBatch.col(unSample) = mxData.col(uidSample(m_mtEngine));
+      }
+      
+      double dInertia = this->miniBatchStep(mxBatch, mxCentroids) / unBatchSize;
+      dSmoothedInertia = (clResult.unIterations == 0 ? dInertia : (1.0 - dSmoothing) * dSmoothedInertia + dSmoothing * dInertia);
+      clResult.unIterations++;
+      
+      if(dSmoothedInertia < dBestInertia * (1.0 - m_dBatchTolerance)) {
+	unStale = 0;
+      } else {
+	unStale++;
+      }
+      
+      dBestInertia = std::min(dBestInertia, dSmoothedInertia);
+    }
+    
+    clResult.vecLabels.resize(unSamples);
+    Parallel::forRange(unSamples, 4096, [&](unsigned int unBegin, unsigned int unEnd) {
+	for(unsigned int unSample = unBegin; unSample < unEnd; ++unSample) {
+	  Eigen::MatrixXf::Index nClosestCentroid;
+	  (mxCentroids.colwise() - mxData.col(unSample)).colwise().squaredNorm().minCoeff(&nClosestCentroid);
+	  
+	  clResult.vecLabels[unSample] = nClosestCentroid;
+	}
+      });
+    
+    clResult.mxCentroids = mxCentroids;
+    clResult.dInertia = this->inertia(clResult);
+    
+    return clResult;
+  }
+  
+  bool KMeans::partialFit(Dataset::Ptr dsBatch, unsigned int unClusters) {
+    if(!dsBatch || dsBatch->count() == 0 || unClusters == 0) {
+      return false;
+    }
+    
+    if(m_clClustering.mxCentroids.cols() != unClusters || m_clClustering.mxCentroids.rows() != dsBatch->dimension() || m_vecCentroidCounts.size() != unClusters) {
+      if(dsBatch->count() < unClusters) {
+	std::cerr << "Need at least " << unClusters << " samples to seed the centroids, got " << dsBatch->count() << "." << std::endl;
+	
+	return false;
+      }
+      
+      m_mtEngine.seed(m_bFixedSeed ? m_ulSeed : std::random_device()());
+      m_clClustering.mxCentroids = this->seed(dsBatch, unClusters);
+      m_clClustering.vecLabels.clear();
+      m_clClustering.unIterations = 0;
+      m_clClustering.unRestart = 0;
+      m_clClustering.vecRestartIterations.clear();
+      m_clClustering.vecRestartInertias.clear();
+      m_vecCentroidCounts.assign(unClusters, 0.0);
+    }
+    
+    m_clClustering.unIterations++;
+    m_clClustering.dInertia = this->miniBatchStep(dsBatch->matrix(), m_clClustering.mxCentroids);
+    
+    // The centroids moved, so earlier labels and clusters are stale;
+    // `clusters()` relabels the source on demand
+    m_clClustering.vecLabels.clear();
+    m_vecClusters.clear();
+    m_bClustersCollected = false;
+    
+    return true;
+  }
+  
+  unsigned int KMeans::closestCentroid(Eigen::VectorXf vxSample) {
+    Eigen::MatrixXf::Index nClosestCentroid = 0;
+    
+    if(m_clClustering.mxCentroids.cols() > 0) {
+      (m_clClustering.mxCentroids.colwise() - vxSample).colwise().squaredNorm().minCoeff(&nClosestCentroid);
+    }
+    
+    return nClosestCentroid;
+  }
+  
+  void KMeans::collectClusters() {
+    m_vecClusters.clear();
+    m_bClustersCollected = true;
+    
+    if(!m_dsSource || m_dsSource->dimension() != (unsigned int)m_clClustering.mxCentroids.rows()) {
+      return;
+    }
+    
+    Dataset::MatrixMap mxData = m_dsSource->matrix();
+    unsigned int unSamples = mxData.cols();
+    unsigned int unClusters = m_clClustering.mxCentroids.cols();
+    std::vector<unsigned int> vecCounts(unClusters, 0);
+    
+    if(m_clClustering.vecLabels.size() != unSamples && unClusters > 0) {
+      // Centroids from `partialFit()`: label the source samples by them
+      m_clClustering.vecLabels.resize(unSamples);
+      
+      for(unsigned int unSample = 0; unSample < unSamples; ++unSample) {
+	m_clClustering.vecLabels[unSample] = this->closestCentroid(mxData.col(unSample));
+      }
+    }
+    
+    for(unsigned int unLabel : m_clClustering.vecLabels) {
+      vecCounts[unLabel]++;
+    }
+    
+    for(unsigned int unI = 0; unI < unClusters; unI++) {
+      m_vecClusters.push_back(Dataset::create(m_dsSource->dimension()));
+      m_vecClusters[unI]->reserve(vecCounts[unI]);
+    }
+    
+    for(unsigned int unSample = 0; unSample < m_clClustering.vecLabels.size(); ++unSample) {
+      m_vecClusters[m_clClustering.vecLabels[unSample]]->add(mxData.col(unSample));
+    }
+  }
+  
   std::vector<Dataset::Ptr> KMeans::clusters() {
+    if(!m_bClustersCollected) {
+      this->collectClusters();
+    }
+    
     return m_vecClusters;
   }
   
+  KMeans::Clustering& KMeans::clustering() {
+    return m_clClustering;
+  }
+  
+  std::vector<unsigned int>& KMeans::labels() {
+    return m_clClustering.vecLabels;
+  }
+  
+  Eigen::MatrixXf& KMeans::centroids() {
+    return m_clClustering.mxCentroids;
+  }
+  
   double KMeans::dissimilarity(Eigen::VectorXf evcPoint, unsigned int unCluster) {
     unsigned int unCount = 0;
     double dDistance = 0.0;
     
-    Dataset::Ptr dsCluster = m_vecClusters[unCluster];
+    Dataset::Ptr dsCluster = this->clusters()[unCluster];
     
     for(unsigned int unI = 0; unI < dsCluster->count(); ++unI) {
       double dSumIntermediate = 0.0;
@@ -211,35 +820,113 @@ namespace mvg {
     return dDistance / (double)dsCluster->count();
   }
   
+  double KMeans::silhouetteValue(double dOwnDissimilarity, double dLowestOtherDissimilarity) {
+    double dSilhouetteValue = 0;
+    
+    if(dOwnDissimilarity < dLowestOtherDissimilarity) {
+      dSilhouetteValue = 1 - dOwnDissimilarity / dLowestOtherDissimilarity;
+    } else if(dOwnDissimilarity > dLowestOtherDissimilarity) {
+      dSilhouetteValue = dLowestOtherDissimilarity / dOwnDissimilarity - 1;
+    }
+    
+    return dSilhouetteValue;
+  }
+  
   std::vector<std::vector<double>> KMeans::silhouettes() {
-    std::vector<std::vector<double>> vecSilhouettes;
+    // Silhouette values of the last clustering, one list per cluster.
+    // As in `dissimilarity()`, the own cluster's mean distance includes
+    // the sample itself.
+    Dataset::MatrixMap mxData = m_dsSource->matrix();
+    std::vector<unsigned int>& vecLabels = m_clClustering.vecLabels;
+    Eigen::MatrixXf& mxCentroids = m_clClustering.mxCentroids;
+    unsigned int unClusters = mxCentroids.cols();
     
-    for(unsigned int unI = 0; unI < m_vecClusters.size(); ++unI) {
-      vecSilhouettes.push_back(std::vector<double>());
+    // The samples that get a value; the exact silhouette also takes the
+    // dissimilarities over these only.
+    std::vector<unsigned int> vecPoints(vecLabels.size());
+    for(unsigned int unSample = 0; unSample < vecPoints.size(); ++unSample) {
+      vecPoints[unSample] = unSample;
+    }
+    
+    if(m_slSilhouette == Sampled && m_unSilhouetteSamples < vecPoints.size()) {
+      // Partial Fisher-Yates shuffle
+      std::mt19937 mtEngine(m_ulSilhouetteSeed);
       
-      for(unsigned int unP = 0; unP < m_vecClusters[unI]->count(); ++unP) {
-	double dOwnDissimilarity = this->dissimilarity((*m_vecClusters[unI])[unP], unI);
-	
-	double dLowestOtherDissimilarity = -1;
-	for(unsigned int unOC = 0; unOC < m_vecClusters.size(); ++unOC) {
-	  if(unOC != unI) {
-	    double dOtherDissimilarity = this->dissimilarity((*m_vecClusters[unI])[unP], unOC);
+      for(unsigned int unSample = 0; unSample < m_unSilhouetteSamples; ++unSample) {
+	std::swap(vecPoints[unSample], vecPoints[std::uniform_int_distribution<unsigned int>(unSample, vecPoints.size() - 1)(mtEngine)]);
+      }
+      
+      vecPoints.resize(m_unSilhouetteSamples);
+      std::sort(vecPoints.begin(), vecPoints.end());
+    }
+    
+    std::vector<double> vecValues(vecPoints.size(), 0.0);
+    
+    if(m_slSilhouette == Simplified) {
+      Parallel::forRange(vecPoints.size(), 4096, [&](unsigned int unBegin, unsigned int unEnd) {
+	  for(unsigned int unPoint = unBegin; unPoint < unEnd; ++unPoint) {
+	    unsigned int unSample = vecPoints[unPoint];
+	    Eigen::VectorXf vxDistances = (mxCentroids.colwise() - mxData.col(unSample)).colwise().norm().transpose();
 	    
-	    if(dLowestOtherDissimilarity < 0 || dOtherDissimilarity < dLowestOtherDissimilarity) {
-	      dLowestOtherDissimilarity = dOtherDissimilarity;
+	    double dLowestOtherDissimilarity = -1;
+	    for(unsigned int unCluster = 0; unCluster < unClusters; ++unCluster) {
+	      if(unCluster != vecLabels[unSample] && (dLowestOtherDissimilarity < 0 || vxDistances[unCluster] < dLowestOtherDissimilarity)) {
+		dLowestOtherDissimilarity = vxDistances[unCluster];
+	      }
 	    }
+	    
+	    vecValues[unPoint] = this->silhouetteValue(vxDistances[vecLabels[unSample]], dLowestOtherDissimilarity);
 	  }
-	}
-	
-	double dSilhouetteValue = 0;
-	if(dOwnDissimilarity < dLowestOtherDissimilarity) {
-	  dSilhouetteValue = 1 - dOwnDissimilarity / dLowestOtherDissimilarity;
-	} else if(dOwnDissimilarity > dLowestOtherDissimilarity) {
-	  dSilhouetteValue = dLowestOtherDissimilarity / dOwnDissimilarity - 1;
-	}
-	
-	vecSilhouettes[unI].push_back(dSilhouetteValue);
+	});
+    } else {
+      // Copy of the samples grouped by cluster, so that the distances
+      // to one cluster are a single contiguous block
+      std::vector<unsigned int> vecCounts(unClusters, 0);
+      for(unsigned int unSample : vecPoints) {
+	vecCounts[vecLabels[unSample]]++;
+      }
+      
+      std::vector<unsigned int> vecOffsets(unClusters + 1, 0);
+      for(unsigned int unCluster = 0; unCluster < unClusters; ++unCluster) {
+	vecOffsets[unCluster + 1] = vecOffsets[unCluster] + vecCounts[unCluster];
       }
+      
+      Eigen::MatrixXf mxGrouped(mxData.rows(), vecPoints.size());
+      std::vector<unsigned int> vecFill(vecOffsets.begin(), vecOffsets.end() - 1);
+      for(unsigned int unSample : vecPoints) {
+	mxGrouped.col(vecFill[vecLabels[unSample]]++) = mxData.col(unSample);
+      }
+      
+      Parallel::forRange(vecPoints.size(), 16, [&](unsigned int unBegin, unsigned int unEnd) {
+	  std::vector<double> vecSums(unClusters);
+	  
+	  for(unsigned int unPoint = unBegin; unPoint < unEnd; ++unPoint) {
+	    unsigned int unSample = vecPoints[unPoint];
+	    Eigen::VectorXf vxSample = mxData.col(unSample);
+	    
+	    for(unsigned int unCluster = 0; unCluster < unClusters; ++unCluster) {
+	      vecSums[unCluster] = (mxGrouped.middleCols(vecOffsets[unCluster], vecCounts[unCluster]).colwise() - vxSample).colwise().norm().cast<double>().sum();
+	    }
+	    
+	    double dLowestOtherDissimilarity = -1;
+	    for(unsigned int unCluster = 0; unCluster < unClusters; ++unCluster) {
+	      if(unCluster != vecLabels[unSample] && vecCounts[unCluster] > 0) {
+		double dOtherDissimilarity = vecSums[unCluster] / vecCounts[unCluster];
+		
+		if(dLowestOtherDissimilarity < 0 || dOtherDissimilarity < dLowestOtherDissimilarity) {
+		  dLowestOtherDissimilarity = dOtherDissimilarity;
+		}
+	      }
+	    }
+	    
+	    vecValues[unPoint] = this->silhouetteValue(vecSums[vecLabels[unSample]] / vecCounts[vecLabels[unSample]], dLowestOtherDissimilarity);
+	  }
+	});
+    }
+    
+    std::vector<std::vector<double>> vecSilhouettes(unClusters);
+    for(unsigned int unPoint = 0; unPoint < vecPoints.size(); ++unPoint) {
+      vecSilhouettes[vecLabels[vecPoints[unPoint]]].push_back(vecValues[unPoint]);
     }
     
     return vecSilhouettes;
@@ -261,4 +948,238 @@ namespace mvg {
     
     return dSum / (double)unCount;
   }
+  
+  std::vector<MultiVarGauss<float>> KMeans::clusterGaussians() {
+    // One Gaussian per cluster; fitting it also gathers the cluster's
+    // sufficient statistics (count, mean, scatter) in a single pass.
+    std::vector<Dataset::Ptr> vecClusters = this->clusters();
+    std::vector<MultiVarGauss<float>> vecGaussians(vecClusters.size());
+    
+    for(unsigned int unCluster = 0; unCluster < vecClusters.size(); ++unCluster) {
+      vecGaussians[unCluster].setDataset(vecClusters[unCluster]);
+    }
+    
+    return vecGaussians;
+  }
+  
+  double KMeans::calinskiHarabasz() {
+    // Between- over within-cluster dispersion, each per degree of freedom
+    std::vector<MultiVarGauss<float>> vecGaussians = this->clusterGaussians();
+    Statistics stTotal;
+    double dWithin = 0.0;
+    
+    for(MultiVarGauss<float>& mvgCluster : vecGaussians) {
+      Statistics& stCluster = mvgCluster.statistics();
+      
+      if(stCluster.count() > 0) {
+	dWithin += stCluster.scatter().trace();
+	stTotal.merge(stCluster);
+      }
+    }
+    
+    unsigned int unClusters = vecGaussians.size();
+    if(unClusters < 2 || stTotal.count() <= unClusters) {
+      return 0.0;
+    }
+    
+    double dBetween = stTotal.scatter().trace() - dWithin;
+    
+    return (dBetween / (unClusters - 1)) / (dWithin / (stTotal.count() - unClusters));
+  }
+  
+  double KMeans::daviesBouldin() {
+    // Mean over the clusters of the worst ratio of summed spreads to
+    // centroid distance
+    std::vector<MultiVarGauss<float>> vecGaussians = this->clusterGaussians();
+    std::vector<Eigen::VectorXd> vecMeans;
+    std::vector<double> vecSpreads;
+    
+    for(MultiVarGauss<float>& mvgCluster : vecGaussians) {
+      Statistics& stCluster = mvgCluster.statistics();
+      
+      if(stCluster.count() > 0) {
+	vecMeans.push_back(stCluster.mean());
+	vecSpreads.push_back(sqrt(stCluster.scatter().trace() / stCluster.count()));
+      }
+    }
+    
+    if(vecMeans.size() < 2) {
+      return std::numeric_limits<double>::infinity();
+    }
+    
+    double dSum = 0.0;
+    for(unsigned int unI = 0; unI < vecMeans.size(); ++unI) {
+      double dWorst = 0.0;
+      
+      for(unsigned int unJ = 0; unJ < vecMeans.size(); ++unJ) {
+	if(unJ != unI) {
+	  dWorst = std::max(dWorst, (vecSpreads[unI] + vecSpreads[unJ]) / (vecMeans[unI] - vecMeans[unJ]).norm());
+	}
+      }
+      
+      dSum += dWorst;
+    }
+    
+    return dSum / vecMeans.size();
+  }
+  
+  double KMeans::bic() {
+    // -2 log L + p log n for the mixture of per-cluster maximum
+    // likelihood Gaussians with hard assignments. With the ML
+    // covariance, the Mahalanobis terms of a cluster sum up to n_c * d,
+    // so log L needs no further pass over the samples.
+    std::vector<MultiVarGauss<float>> vecGaussians = this->clusterGaussians();
+    unsigned long ulSamples = 0;
+    unsigned int unClusters = 0;
+    unsigned int unDimension = m_dsSource->dimension();
+    
+    for(MultiVarGauss<float>& mvgCluster : vecGaussians) {
+      if(mvgCluster.statistics().count() > 0) {
+	ulSamples += mvgCluster.statistics().count();
+	unClusters++;
+      }
+    }
+    
+    double dLogLikelihood = 0.0;
+    for(MultiVarGauss<float>& mvgCluster : vecGaussians) {
+      double dCount = mvgCluster.statistics().count();
+      
+      if(dCount > 0) {
+	MultiVarGauss<float>::Model& mdlModel = mvgCluster.model();
+	
+	if(!mdlModel.bValid) {
+	  // Degenerate cluster, unbounded likelihood
+	  return std::numeric_limits<double>::infinity();
+	}
+	
+	dLogLikelihood += dCount * (log(dCount / ulSamples) + mdlModel.fLogNormalization - 0.5 * unDimension);
+      }
+    }
+    
+    double dParameters = (unClusters - 1) + unClusters * (unDimension + unDimension * (unDimension + 1) / 2.0);
+    
+    return -2.0 * dLogLikelihood + dParameters * log((double)ulSamples);
+  }
+  
+  double KMeans::score(Criterion crCriterion, unsigned int unClusters) {
+    // Clusters with `unClusters` and rates the result, higher is better
+    switch(crCriterion) {
+    case CalinskiHarabasz:
+      this->calculate(unClusters);
+      return this->calinskiHarabasz();
+    
+    case DaviesBouldin:
+      this->calculate(unClusters);
+      return -this->daviesBouldin();
+    
+    case BIC:
+      this->calculate(unClusters);
+      return -this->bic();
+    
+    default:
+      return this->silhouetteAverage(unClusters);
+    }
+  }
+}
+
+
+static bool clusterRows(mvg::Dataset::Ptr dsData, int nClusters, unsigned long ulSeed, int* pnLabels, Eigen::MatrixXf& mxCentroids, double dTolerance = 0.0) {
+  if(nClusters <= 0 || dsData->dimension() == 0 || dsData->count() < (unsigned int)nClusters) {
+    std::cerr << "Cannot cluster " << dsData->count() << " samples into " << nClusters << " clusters." << std::endl;
+    
+    return false;
+  }
+  
+  mvg::KMeans kmMeans;
+  kmMeans.setSource(dsData);
+  kmMeans.setSeed(ulSeed);
+  
+  if(dTolerance > 0.0) {
+    kmMeans.setTolerance(dTolerance);
+  }
+  
+  if(!kmMeans.calculate(nClusters)) {
+    return false;
+  }
+  
+  if(pnLabels) {
+    std::copy(kmMeans.labels().begin(), kmMeans.labels().end(), pnLabels);
+  }
+  
+  mxCentroids = kmMeans.centroids();
+  
+  return true;
+}
+
+extern "C" int k_means_float(const float* pfData, int nRows, int nDimension, int nClusters, unsigned long ulSeed, int* pnLabels, float* pfCentroids) {
+  if(!pfData || nRows <= 0 || nDimension <= 0) {
+    return 0;
+  }
+  
+  // A view on the caller's buffer; KMeans never writes to its source
+  mvg::Dataset::Ptr dsData = mvg::Dataset::create(const_cast<float*>(pfData), (unsigned int)nDimension, (unsigned int)nRows, std::shared_ptr<void>());
+  Eigen::MatrixXf mxCentroids;
+  
+  if(!clusterRows(dsData, nClusters, ulSeed, pnLabels, mxCentroids)) {
+    return 0;
+  }
+  
+  if(pfCentroids) {
+    Eigen::Map<Eigen::MatrixXf>(pfCentroids, nDimension, nClusters) = mxCentroids;
+  }
+  
+  return 1;
+}
+
+extern "C" int k_means_double(const double* pdData, int nRows, int nDimension, int nClusters, unsigned long ulSeed, int* pnLabels, double* pdCentroids) {
+  if(!pdData || nRows <= 0 || nDimension <= 0) {
+    return 0;
+  }
+  
+  // Converted once into a buffer that the dataset uses as it is
+  std::shared_ptr<float> shpBuffer(new float[(size_t)nRows * nDimension], std::default_delete<float[]>());
+  Eigen::Map<Eigen::MatrixXf>(shpBuffer.get(), nDimension, nRows) = Eigen::Map<const Eigen::MatrixXd>(pdData, nDimension, nRows).cast<float>();
+  
+  mvg::Dataset::Ptr dsData = mvg::Dataset::create(shpBuffer.get(), (unsigned int)nDimension, (unsigned int)nRows, std::shared_ptr<void>(shpBuffer));
+  Eigen::MatrixXf mxCentroids;
+  
+  if(!clusterRows(dsData, nClusters, ulSeed, pnLabels, mxCentroids)) {
+    return 0;
+  }
+  
+  if(pdCentroids) {
+    Eigen::Map<Eigen::MatrixXd>(pdCentroids, nDimension, nClusters) = mxCentroids.cast<double>();
+  }
+  
+  return 1;
+}
+
+extern "C" int* k_means(double** data, int n, int m, int k, double t, double** centroids) {
+  if(!data || n <= 0 || m <= 0) {
+    return NULL;
+  }
+  
+  mvg::Dataset::Ptr dsData = mvg::Dataset::create(m);
+  dsData->reserve(n);
+  
+  for(int nRow = 0; nRow < n; ++nRow) {
+    dsData->add(Eigen::Map<const Eigen::VectorXd>(data[nRow], m).cast<float>());
+  }
+  
+  int* pnLabels = (int*)malloc(n * sizeof(int));
+  Eigen::MatrixXf mxCentroids;
+  
+  if(!pnLabels || !clusterRows(dsData, k, 0, pnLabels, mxCentroids, t)) {
+    free(pnLabels);
+    
+    return NULL;
+  }
+  
+  if(centroids) {
+    for(int nCluster = 0; nCluster < k; ++nCluster) {
+      Eigen::Map<Eigen::VectorXd>(centroids[nCluster], m) = mxCentroids.col(nCluster).cast<double>();
+    }
+  }
+  
+  return pnLabels;
 }
@@ -0,0 +1,182 @@
+#include <mvg/Parallel.h>
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <vector>
+#include <algorithm>
+
+
+namespace mvg {
+  // Worker threads started on first use and kept until the process
+  // exits, so that loops don't pay for thread creation. One job (the
+  // chunks of one `forRange()` call) runs at a time; a job asks for a
+  // number of helpers, and workers that join late (after the caller
+  // ran out of chunks) are turned away rather than waited for.
+  class WorkerPool {
+  private:
+    std::mutex m_mtxJob; // Serializes jobs of different callers
+    std::mutex m_mtxState;
+    std::condition_variable m_cvWork;
+    std::condition_variable m_cvDone;
+    std::vector<std::thread> m_vecThreads;
+    const std::function<void()>* m_pfncJob;
+    unsigned long m_ulGeneration;
+    unsigned int m_unWanted; // Helpers the current job still takes
+    unsigned int m_unRunning; // Helpers inside the current job
+    bool m_bStop;
+    
+    void work() {
+      unsigned long ulSeen = 0;
+      std::unique_lock<std::mutex> lkState(m_mtxState);
+      
+      while(true) {
+	m_cvWork.wait(lkState, [&]() { return m_bStop || (m_ulGeneration != ulSeen && m_unWanted > 0); });
+	
+	if(m_bStop) {
+	  return;
+	}
+	
+	ulSeen = m_ulGeneration;
+	m_unWanted--;
+	m_unRunning++;
+	const std::function<void()>* pfncJob = m_pfncJob;
+	
+	lkState.unlock();
+	(*pfncJob)();
+	lkState.lock();
+	
+	if(--m_unRunning == 0) {
+	  m_cvDone.notify_all();
+	}
+      }
+    }
+  
+  public:
+    WorkerPool() : m_pfncJob(nullptr), m_ulGeneration(0), m_unWanted(0), m_unRunning(0), m_bStop(false) {
+    }
+    
+    ~WorkerPool() {
+      {
+	std::lock_guard<std::mutex> lgState(m_mtxState);
+	m_bStop = true;
+      }
+      
+      m_cvWork.notify_all();
+      
+      for(std::thread& thrWorker : m_vecThreads) {
+	thrWorker.join();
+      }
+    }
+    
+    void run(unsigned int unHelpers, const std::function<void()>& fncJob) {
+      // Runs `fncJob` on the calling thread and on up to `unHelpers`
+      // workers; returns once all of them are done with it.
+      std::lock_guard<std::mutex> lgJob(m_mtxJob);
+      
+      {
+	std::lock_guard<std::mutex> lgState(m_mtxState);
+	
+	while(m_vecThreads.size() < unHelpers) {
+	  m_vecThreads.push_back(std::thread([this]() { this->work(); }));
+	}
+	
+	m_pfncJob = &fncJob;
+	m_ulGeneration++;
+	m_unWanted = unHelpers;
+      }
+      
+      m_cvWork.notify_all();
+      fncJob();
+      
+      std::unique_lock<std::mutex> lkState(m_mtxState);
+      m_unWanted = 0;
+      m_cvDone.wait(lkState, [this]() { return m_unRunning == 0; });
+      m_pfncJob = nullptr;
+    }
+  };
+  
+  static WorkerPool s_wpPool;
+  
+  unsigned int Parallel::s_unThreads = 0;
+  thread_local bool Parallel::s_bInside = false;
+  
+  unsigned int Parallel::threads() {
+    if(s_unThreads > 0) {
+      return s_unThreads;
+    }
+    
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+  
+  void Parallel::setThreads(unsigned int unThreads) {
+    s_unThreads = unThreads;
+  }
+  
+  unsigned int Parallel::chunks(unsigned int unCount, unsigned int unGrain) {
+    unGrain = std::max(1u, unGrain);
+    
+    return (unCount + unGrain - 1) / unGrain;
+  }
+  
+  void Parallel::forRange(unsigned int unCount, unsigned int unGrain, RangeFunction fncBody, unsigned int unThreads) {
+    unGrain = std::max(1u, unGrain);
+    unsigned int unChunks = Parallel::chunks(unCount, unGrain);
+    
+    if(unThreads == 0) {
+      unThreads = Parallel::threads();
+    }
+    
+    unThreads = std::min(unThreads, unChunks);
+    if(s_bInside) {
+      // Already on a worker; the outer loop keeps all threads busy
+      unThreads = 1;
+    }
+    
+    if(unThreads <= 1) {
+      for(unsigned int unBegin = 0; unBegin < unCount; unBegin += unGrain) {
+	fncBody(unBegin, std::min(unCount, unBegin + unGrain));
+      }
+      
+      return;
+    }
+    
+    // The first exception thrown by the body stops handing out chunks
+    // and is rethrown here once all threads are done.
+    std::atomic<unsigned int> aunNextChunk(0);
+    std::mutex mtxException;
+    std::exception_ptr expException;
+    
+    std::function<void()> fncWorker = [&]() {
+      unsigned int unChunk;
+      bool bWasInside = s_bInside;
+      s_bInside = true;
+      
+      while((unChunk = aunNextChunk++) < unChunks) {
+	unsigned int unBegin = unChunk * unGrain;
+	
+	try {
+	  fncBody(unBegin, std::min(unCount, unBegin + unGrain));
+	} catch(...) {
+	  std::lock_guard<std::mutex> lgException(mtxException);
+	  
+	  if(!expException) {
+	    expException = std::current_exception();
+	  }
+	  
+	  aunNextChunk = unChunks;
+	}
+      }
+      
+      s_bInside = bWasInside;
+    };
+    
+    s_wpPool.run(unThreads - 1, fncWorker);
+    
+    if(expException) {
+      std::rethrow_exception(expException);
+    }
+  }
+}
@@ -0,0 +1,132 @@
+#include <mvg/Random.h>
+
+#include <cmath>
+#include <algorithm>
+
+
+namespace mvg {
+  Random::Random(uint64_t ulSeed, uint64_t ulStream) : m_ulKey(ulSeed), m_ulStream(ulStream), m_ulCounter(0), m_unUsed(4), m_fSpareNormal(0.0), m_bHasSpareNormal(false) {
+  }
+  
+  Random::~Random() {
+  }
+  
+  Random::Block Random::philox(Block blkCounter, uint64_t ulKey) {
+    uint32_t unKey0 = (uint32_t)ulKey;
+    uint32_t unKey1 = (uint32_t)(ulKey >> 32);
+    
+    for(unsigned int unRound = 0; unRound < 10; ++unRound) {
+      uint64_t ulProduct0 = (uint64_t)0xD2511F53 * blkCounter[0];
+      uint64_t ulProduct1 = (uint64_t)0xCD9E8D57 * blkCounter[2];
+      
+      blkCounter = {(uint32_t)(ulProduct1 >> 32) ^ blkCounter[1] ^ unKey0,
+		    (uint32_t)ulProduct1,
+		    (uint32_t)(ulProduct0 >> 32) ^ blkCounter[3] ^ unKey1,
+		    (uint32_t)ulProduct0};
+      
+      unKey0 += 0x9E3779B9;
+      unKey1 += 0xBB67AE85;
+    }
+    
+    return blkCounter;
+  }
+  
+  uint32_t Random::next() {
+    if(m_unUsed == 4) {
+      m_blkBuffer = Random::philox({(uint32_t)m_ulCounter, (uint32_t)(m_ulCounter >> 32), (uint32_t)m_ulStream, (uint32_t)(m_ulStream >> 32)}, m_ulKey);
+      m_ulCounter++;
+      m_unUsed = 0;
+    }
+    
+    return m_blkBuffer[m_unUsed++];
+  }
+  
+  float Random::uniform() {
+    // Upper 24 bits, shifted away from zero
+    return ((this->next() >> 8) + 1) * (1.0f / 16777216.0f);
+  }
+  
+  float Random::normal() {
+    if(m_bHasSpareNormal) {
+      m_bHasSpareNormal = false;
+      
+      return m_fSpareNormal;
+    }
+    
+    float fRadius = std::sqrt(-2.0f * std::log(this->uniform()));
+    float fAngle = 2.0f * (float)M_PI * this->uniform();
+    
+    m_fSpareNormal = fRadius * std::sin(fAngle);
+    m_bHasSpareNormal = true;
+    
+    return fRadius * std::cos(fAngle);
+  }
+  
+  void Random::uniforms(float* pfValues, unsigned int unCount) {
+    for(unsigned int unI = 0; unI < unCount; ++unI) {
+      pfValues[unI] = this->uniform();
+    }
+  }
+  
+  void Random::normals(float* pfValues, unsigned int unCount) {
+    for(unsigned int unI = 0; unI < unCount; ++unI) {
+      pfValues[unI] = this->normal();
+    }
+  }
+  
+  AliasTable::AliasTable(const std::vector<double>& vecWeights) {
+    unsigned int unSize = vecWeights.size();
+    double dWeightSum = 0.0;
+    std::vector<double> vecScaled(unSize);
+    std::vector<unsigned int> vecSmall, vecLarge;
+    
+    for(double dWeight : vecWeights) {
+      dWeightSum += std::max(dWeight, 0.0);
+    }
+    
+    m_vecProbabilities.resize(unSize, 1.0);
+    m_vecAliases.resize(unSize);
+    
+    for(unsigned int unI = 0; unI < unSize; ++unI) {
+      vecScaled[unI] = (dWeightSum > 0.0 ? std::max(vecWeights[unI], 0.0) * unSize / dWeightSum : 1.0);
+      m_vecAliases[unI] = unI;
+      
+      if(vecScaled[unI] < 1.0) {
+	vecSmall.push_back(unI);
+      } else {
+	vecLarge.push_back(unI);
+      }
+    }
+    
+    while(!vecSmall.empty() && !vecLarge.empty()) {
+      unsigned int unSmall = vecSmall.back();
+      unsigned int unLarge = vecLarge.back();
+      vecSmall.pop_back();
+      
+      m_vecProbabilities[unSmall] = vecScaled[unSmall];
+      m_vecAliases[unSmall] = unLarge;
+      vecScaled[unLarge] -= 1.0 - vecScaled[unSmall];
+      
+      if(vecScaled[unLarge] < 1.0) {
+	vecLarge.pop_back();
+	vecSmall.push_back(unLarge);
+      }
+    }
+    
+    // Whatever is left over only differs from 1 by rounding errors and
+    // keeps its probability of 1
+  }
+  
+  AliasTable::~AliasTable() {
+  }
+  
+  unsigned int AliasTable::size() {
+    return m_vecProbabilities.size();
+  }
+  
+  unsigned int AliasTable::draw(Random& rndRandom) {
+    unsigned int unColumn = std::min((unsigned int)(rndRandom.uniform() * m_vecProbabilities.size()), (unsigned int)m_vecProbabilities.size() - 1);
+    
+    return (rndRandom.uniform() <= m_vecProbabilities[unColumn] ? unColumn : m_vecAliases[unColumn]);
+  }
+}
@@ -0,0 +1,110 @@
+#include <mvg/RasterFile.h>
+
+#include <fstream>
+#include <cstring>
+
+
+namespace mvg {
+  static const char* s_acMagic = "MVGR";
+  static const uint32_t s_unVersion = 1;
+  
+  RasterFile::Format RasterFile::formatFor(std::string strFilepath) {
+    std::string strExtension = ".mvgr";
+    
+    if(strFilepath.size() >= strExtension.size() &&
+       strFilepath.compare(strFilepath.size() - strExtension.size(), strExtension.size(), strExtension) == 0) {
+      return Binary;
+    }
+    
+    return CSV;
+  }
+  
+  bool RasterFile::writeCSV(std::ostream& osStream, Grid grdGrid, const float* pfValues) {
+    // '\n' instead of std::endl: the stream is flushed once at the
+    // end, not after every line.
+    for(unsigned int unX = 0; unX < grdGrid.unCountX; ++unX) {
+      float fX = grdGrid.x(unX);
+      
+      for(unsigned int unY = 0; unY < grdGrid.unCountY; ++unY) {
+	osStream << fX << ", " << grdGrid.y(unY) << ", " << pfValues[(size_t)unX * grdGrid.unCountY + unY] << '\n';
+      }
+    }
+    
+    osStream.flush();
+    
+    return osStream.good();
+  }
+  
+  bool RasterFile::writeBinary(std::ostream& osStream, Grid grdGrid, const float* pfValues) {
+    Header hdrHeader;
+    std::memcpy(hdrHeader.acMagic, s_acMagic, 4);
+    hdrHeader.unVersion = s_unVersion;
+    hdrHeader.fOriginX = grdGrid.fOriginX;
+    hdrHeader.fOriginY = grdGrid.fOriginY;
+    hdrHeader.fStepX = grdGrid.fStepX;
+    hdrHeader.fStepY = grdGrid.fStepY;
+    hdrHeader.unCountX = grdGrid.unCountX;
+    hdrHeader.unCountY = grdGrid.unCountY;
+    
+    osStream.write((const char*)&hdrHeader, sizeof(Header));
+    osStream.write((const char*)pfValues, sizeof(float) * grdGrid.size());
+    osStream.flush();
+    
+    return osStream.good();
+  }
+  
+  bool RasterFile::write(std::ostream& osStream, Grid grdGrid, const float* pfValues, Format fmtFormat) {
+    if(fmtFormat == Binary) {
+      return RasterFile::writeBinary(osStream, grdGrid, pfValues);
+    }
+    
+    return RasterFile::writeCSV(osStream, grdGrid, pfValues);
+  }
+  
+  bool RasterFile::write(std::string strFilepath, Grid grdGrid, const float* pfValues) {
+    Format fmtFormat = RasterFile::formatFor(strFilepath);
+    std::ofstream ofFile(strFilepath, std::ios::out | std::ios::trunc | (fmtFormat == Binary ? std::ios::binary : std::ios::openmode()));
+    
+    if(!ofFile.good()) {
+      std::cerr << "Couldn't open file '" << strFilepath << "' for writing" << std::endl;
+      return false;
+    }
+    
+    return RasterFile::write(ofFile, grdGrid, pfValues, fmtFormat);
+  }
+  
+  bool RasterFile::write(std::string strFilepath, Grid grdGrid, std::vector<float>& vecValues) {
+    return RasterFile::write(strFilepath, grdGrid, vecValues.data());
+  }
+  
+  bool RasterFile::read(std::string strFilepath, Grid& grdGrid, std::vector<float>& vecValues) {
+    std::ifstream ifFile(strFilepath, std::ios::in | std::ios::binary);
+    Header hdrHeader;
+    
+    if(!ifFile.good() || !ifFile.read((char*)&hdrHeader, sizeof(Header)) || std::memcmp(hdrHeader.acMagic, s_acMagic, 4) != 0) {
+      std::cerr << "Not a binary raster: '" << strFilepath << "'" << std::endl;
+      return false;
+    }
+    
+    if(hdrHeader.unVersion != s_unVersion) {
+      std::cerr << "Unsupported binary raster version " << hdrHeader.unVersion << ": '" << strFilepath << "'" << std::endl;
+      return false;
+    }
+    
+    grdGrid.fOriginX = hdrHeader.fOriginX;
+    grdGrid.fOriginY = hdrHeader.fOriginY;
+    grdGrid.fStepX = hdrHeader.fStepX;
+    grdGrid.fStepY = hdrHeader.fStepY;
+    grdGrid.unCountX = hdrHeader.unCountX;
+    grdGrid.unCountY = hdrHeader.unCountY;
+    
+    vecValues.resize(grdGrid.size());
+    
+    if(!ifFile.read((char*)vecValues.data(), sizeof(float) * vecValues.size())) {
+      std::cerr << "Truncated binary raster: '" << strFilepath << "'" << std::endl;
+      return false;
+    }
+    
+    return true;
+  }
+}
@@ -13,6 +13,10 @@
 #include <string>
 
 #include <mvg/KMeans.h>
+#include <mvg/DatasetFile.h>
+#include <mvg/GridRasterizer.hpp>
+#include <mvg/Parallel.h>
+#include <mvg/RasterFile.h>
 #include <mvg/MixedGaussians.hpp>
 
 
@@ -40,57 +44,40 @@ std::string makeOutputFilename(std::string strFileIn) {
 }
 
 
-mvg::Dataset::Ptr loadCSV(std::string strFilepath, std::vector<unsigned int> vecUsedIndices = {}) {
-  mvg::Dataset::Ptr dsData = nullptr;
+// Relative error accepted per raster cell for skipping far away
+// mixture components
+const double dRasterTolerance = 1e-6;
+// Rasterized area around every mixture component, in standard
+// deviations
+const double dBoundingSigmas = 4.0;
+
+void rasterizeMixture(mvg::MixedGaussians<double>& mgGaussians, mvg::Grid grdGrid, std::vector<float>& vecDensities) {
+  mvg::GridRasterizer<double> grsRasterizer(grdGrid);
   
-  std::ifstream ifFile(strFilepath, std::ios::in);
+  grsRasterizer.setTolerance(dRasterTolerance);
+  grsRasterizer.addMixture(mgGaussians);
+  grsRasterizer.rasterize(vecDensities);
+}
+
+bool mixtureBoundingBox(mvg::MixedGaussians<double>& mgGaussians, mvg::MultiVarGauss<double>::Rect& rctBB) {
+  // Sigma box of the mixture, or the extent of its data if no
+  // component takes part in the density; false if neither spans two
+  // dimensions.
+  rctBB = mgGaussians.sigmaBox(dBoundingSigmas);
   
-  if(ifFile.good()) {
-    dsData = mvg::Dataset::create();
-    
-    std::string strLine;
-    std::getline(ifFile, strLine); // Header
-    while(std::getline(ifFile, strLine)) {
-      std::vector<std::string> vecTokens;
-      
-      char* cToken = std::strtok((char*)strLine.c_str(), ",");
-      while(cToken != nullptr) {
-	vecTokens.push_back(cToken);
-	cToken = std::strtok(NULL, ",");
-      }
-      
-      std::vector<double> vecData;
-      for(unsigned int unI = 0; unI < vecTokens.size(); ++unI) {
-	if(vecUsedIndices.size() == 0 || std::find(vecUsedIndices.begin(), vecUsedIndices.end(), unI) != vecUsedIndices.end()) {
-	  std::string strToken = vecTokens[unI];
-	  
-	  try {
-	    vecData.push_back(std::stod(strToken));
-	  } catch(std::exception& seException) {
-	    vecData.push_back(0.0);
-	  }
-	}
-      }
-      
-      if(vecData.size() > 0) {
-	Eigen::VectorXf vxdData(vecData.size());
-	for(unsigned int unI = 0; unI < vecData.size(); ++unI) {
-	  vxdData[unI] = vecData[unI];
-	}
-	
-	dsData->add(vxdData);
-      }
-    }
+  if(rctBB.vecMin.size() < 2) {
+    rctBB = mgGaussians.boundingBox();
   }
   
-  return dsData;
+  return rctBB.vecMin.size() >= 2;
 }
 
-void clusterizeDataset (mvg::KMeans& kmean, unsigned int& maxCluster, mvg::Dataset::Ptr dsData, std::vector<mvg::Dataset::Ptr> vecCluster)
+void clusterizeDataset (mvg::KMeans& kmean, unsigned int& maxCluster, mvg::Dataset::Ptr dsData, std::vector<mvg::Dataset::Ptr>& vecCluster)
 {
    kmean.setSource(dsData);
    std::cout << "Calculating kMeans clusters .. " << std::flush;
-   kmean.calculate(1, maxCluster);
+   // BIC needs no quadratic step, unlike the silhouette
+   kmean.calculate(1, maxCluster, mvg::KMeans::BIC);
 
    std::cout << "done" << std::endl;
 	  
@@ -105,7 +92,7 @@ void clusterizeDataset (mvg::KMeans& kmean, unsigned int& maxCluster, mvg::Datas
 	  
    unsigned int unRemovedOutliers = dsData->count() - unSumSamplesUsed;
    if(unRemovedOutliers > 0) {
-      std::cout << "Removed " << unRemovedOutliers << " outlier" << (unRemovedOutliers == 1 ? "" : "s") << " from positive dataset" << std::endl;
+      std::cout << "Removed " << unRemovedOutliers << " outlier" << (unRemovedOutliers == 1 ? "" : "s") << " from dataset" << std::endl;
    }
 }
 
@@ -113,11 +100,8 @@ void addDataSetsToMixedGaussian (unsigned int& maxCluster, mvg::Dataset::Ptr dsD
 {
    if (maxCluster > 1)
    {
-      for(mvg::Dataset::Ptr dsCluster : vecCluster) {
-         mvg::MultiVarGauss<double>::Ptr mvgGaussian = mvg::MultiVarGauss<double>::create();
-         mvgGaussian->setDataset(dsCluster);
-	 mgGaussians.addGaussian(mvgGaussian, 1.0);
-      }
+      // EM, initialized from the clusters
+      mgGaussians.fit(vecCluster);
    }
    else
    {
@@ -128,7 +112,7 @@ void addDataSetsToMixedGaussian (unsigned int& maxCluster, mvg::Dataset::Ptr dsD
 }
 
 void calculateClustersandBoundingBoxes(unsigned int& positiveClusterNumber, unsigned int& negativeClusterNumber, mvg::Dataset::Ptr dsDataPos, mvg::Dataset::Ptr dsDataNeg, 
-                                       std::vector<mvg::Dataset::Ptr> vecClustersPos, std::vector<mvg::Dataset::Ptr> vecClustersNeg, mvg::MixedGaussians<double>& mgGaussiansPos, 
+                                       std::vector<mvg::Dataset::Ptr>& vecClustersPos, std::vector<mvg::Dataset::Ptr>& vecClustersNeg, mvg::MixedGaussians<double>& mgGaussiansPos, 
                                        mvg::MixedGaussians<double>& mgGaussiansNeg, double& min_x, double& min_y, double& max_x, double& max_y)
 {
    mvg::KMeans kmMeansPos;
@@ -140,14 +124,21 @@ void calculateClustersandBoundingBoxes(unsigned int& positiveClusterNumber, unsi
 
    if (negativeClusterNumber > 1)
    {
-      clusterizeDataset (kmMeansPos, positiveClusterNumber, dsDataPos, vecClustersPos);
+      clusterizeDataset (kmMeansNeg, negativeClusterNumber, dsDataNeg, vecClustersNeg);
    }
 
    addDataSetsToMixedGaussian(positiveClusterNumber, dsDataPos, vecClustersPos, mgGaussiansPos);
-   addDataSetsToMixedGaussian(negativeClusterNumber, dsDataNeg, vecClustersPos, mgGaussiansNeg);
+   addDataSetsToMixedGaussian(negativeClusterNumber, dsDataNeg, vecClustersNeg, mgGaussiansNeg);
 
-   mvg::MultiVarGauss<double>::Rect rctBBPos = mgGaussiansPos.boundingBox();
-   mvg::MultiVarGauss<double>::Rect rctBBNeg = mgGaussiansNeg.boundingBox();
+   mvg::MultiVarGauss<double>::Rect rctBBPos;
+   
+   if(!mixtureBoundingBox(mgGaussiansPos, rctBBPos)) {
+      std::cerr << "Error: Positive mixture has no two dimensional bounding box" << std::endl;
+      min_x = min_y = max_x = max_y = 0.0;
+      
+      return;
+   }
+   
    /*if(rctBBPos.vecMin[0] > rctBBNeg.vecMin[0]) min_x = rctBBNeg.vecMin[0]; else min_x = rctBBPos.vecMin[0];
     if(rctBBPos.vecMin[1] > rctBBNeg.vecMin[1]) min_y = rctBBNeg.vecMin[1]; else min_y = rctBBPos.vecMin[1];
     if(rctBBPos.vecMax[0] > rctBBNeg.vecMax[0]) max_x = rctBBPos.vecMax[0]; else max_x = rctBBNeg.vecMax[0];
@@ -196,11 +187,12 @@ JNIEXPORT void JNICALL Java_org_knowrob_gaussian_MixedGaussianInterface_analyzeC
       std::cout << "Cluster Analysis: '" << strFileIn << "' --> '" << strFileOut << "'" << std::endl;
       
       mvg::KMeans kmMeans;
-      mvg::Dataset::Ptr dsData = loadCSV(strFileIn, {0, 1});
+      mvg::Dataset::Ptr dsData = mvg::DatasetFile::load(strFileIn, {0, 1});
       std::cout << "Dataset: " << dsData->count() << " samples with " << dsData->dimension() << " dimension" << (dsData->dimension() == 1 ? "" : "s") << std::endl;
       
       if(dsData) {
 	kmMeans.setSource(dsData);
+	kmMeans.setSilhouette(mvg::KMeans::Sampled, 5000);
 	std::cout << "Calculating KMeans clusters .. " << std::flush;
 	
 	if(kmMeans.calculate(1, 5)) {
@@ -222,38 +214,32 @@ JNIEXPORT void JNICALL Java_org_knowrob_gaussian_MixedGaussianInterface_analyzeC
 	  
 	  mvg::MixedGaussians<double> mgGaussians;
 	  
-	  for(mvg::Dataset::Ptr dsCluster : vecClusters) {
-	    mvg::MultiVarGauss<double>::Ptr mvgGaussian = mvg::MultiVarGauss<double>::create();
-	    mvgGaussian->setDataset(dsCluster);
-	    //mvgGaussian->setDataset(dsData);
-	    mgGaussians.addGaussian(mvgGaussian, 1.0);
-	    //break;
-	  }
-	  
-	  mvg::MultiVarGauss<double>::Rect rctBB = mgGaussians.boundingBox();
-          mvg::MultiVarGauss<double>::DensityFunction fncDensity = mgGaussians.densityFunction();
-	  
-	  std::cout << "Clusters bounding box: [" << rctBB.vecMin[0] << ", " << rctBB.vecMin[1] << "] --> [" << rctBB.vecMax[0] << ", " << rctBB.vecMax[1] << "]" << std::endl;
+	  std::cout << "Fitting mixture (EM) .. " << std::flush;
+	  mgGaussians.fit(vecClusters);
+	  std::cout << "done (" << mgGaussians.logLikelihoods().size() << " iterations)" << std::endl;
 	  
-	  // Two dimensional case
-	  float fStepSizeX = 0.01;
-	  float fStepSizeY = 0.01;
+	  mvg::MultiVarGauss<double>::Rect rctBB;
 	  
-	  std::cout << "Writing CSV file (step size = [" << fStepSizeX << ", " << fStepSizeY << "]) .. " << std::endl;
-	  
-	  std::ofstream ofFile(strFileOut, std::ios::out);
-	  
-	  for(float fX = rctBB.vecMin[0]; fX < rctBB.vecMax[0]; fX += fStepSizeX) {
-	    for(float fY = rctBB.vecMin[1]; fY < rctBB.vecMax[1]; fY += fStepSizeY) {
-              float fValue = fncDensity({fX, fY});
-	      ofFile << fX << ", " << fY << ", " << fValue << std::endl;
-	    }
+	  if(mixtureBoundingBox(mgGaussians, rctBB)) {
+	    std::cout << "Clusters bounding box: [" << rctBB.vecMin[0] << ", " << rctBB.vecMin[1] << "] --> [" << rctBB.vecMax[0] << ", " << rctBB.vecMax[1] << "]" << std::endl;
+	    
+	    // Two dimensional case
+	    float fStepSizeX = 0.01;
+	    float fStepSizeY = 0.01;
+	    
+	    std::cout << "Writing " << (mvg::RasterFile::formatFor(strFileOut) == mvg::RasterFile::Binary ? "binary raster" : "CSV") << " file (step size = [" << fStepSizeX << ", " << fStepSizeY << "]) .. " << std::endl;
+	    
+	    mvg::Grid grdGrid = mvg::Grid::fromBoundingBox(rctBB.vecMin[0], rctBB.vecMin[1], rctBB.vecMax[0], rctBB.vecMax[1], fStepSizeX, fStepSizeY);
+	    std::vector<float> vecDensities;
+	    rasterizeMixture(mgGaussians, grdGrid, vecDensities);
+	    
+	    mvg::RasterFile::write(strFileOut, grdGrid, vecDensities);
+	    
+	    std::cout << "done" << std::endl;
+	  } else {
+	    std::cerr << "Error: Mixture has no two dimensional bounding box" << std::endl;
 	  }
 	  
-	  ofFile.close();
-	  
-	  std::cout << "done" << std::endl;
-	  
 	} else {
 	  std::cout << "failed" << std::endl;
 	}
@@ -281,9 +267,9 @@ JNIEXPORT jdoubleArray JNICALL Java_org_knowrob_gaussian_MixedGaussianInterface_
     if(fileExists(strPosFile) & fileExists(strNegFile)) {
       std::cout << "Trial Analysis: '" << strPosFile << "' & '" << strNegFile << "'" << std::endl;
       
-      mvg::Dataset::Ptr dsDataPos = loadCSV(strPosFile, {0, 1});
+      mvg::Dataset::Ptr dsDataPos = mvg::DatasetFile::load(strPosFile, {0, 1});
       std::cout << "Positive Dataset: " << dsDataPos->count() << " samples with " << dsDataPos->dimension() << " dimension" << (dsDataPos->dimension() == 1 ? "" : "s") << std::endl;
-      mvg::Dataset::Ptr dsDataNeg = loadCSV(strNegFile, {0, 1});
+      mvg::Dataset::Ptr dsDataNeg = mvg::DatasetFile::load(strNegFile, {0, 1});
       std::cout << "Negative Dataset: " << dsDataNeg->count() << " samples with " << dsDataNeg->dimension() << " dimension" << (dsDataNeg->dimension() == 1 ? "" : "s") << std::endl;
       
       if(dsDataPos && dsDataNeg) {
@@ -301,37 +287,62 @@ JNIEXPORT jdoubleArray JNICALL Java_org_knowrob_gaussian_MixedGaussianInterface_
 	float fStepSizeX = 0.01;
 	float fStepSizeY = 0.01;
 	  
-	std::cout << "Writing CSV file (step size = [" << fStepSizeX << ", " << fStepSizeY << "]) .. " << std::endl;
-	  
-	std::ofstream ofFile(strFileOut, std::ios::out);
+	std::cout << "Writing " << (mvg::RasterFile::formatFor(strFileOut) == mvg::RasterFile::Binary ? "binary raster" : "CSV") << " file (step size = [" << fStepSizeX << ", " << fStepSizeY << "]) .. " << std::endl;
 	 
 	jdoubleArray maximized_expectation = env->NewDoubleArray(2);
 	float maxValue = -1;
 	float maxValueIndX = -1;
 	float maxValueIndY = -1;
 	   
-        mvg::MultiVarGauss<double>::DensityFunction fncDensityPos = mgGaussiansPos.densityFunction();
-        mvg::MultiVarGauss<double>::DensityFunction fncDensityNeg = mgGaussiansNeg.densityFunction();
-	for(float fX = min_x; fX < max_x; fX += fStepSizeX) {
-	  for(float fY = min_y; fY < max_y; fY += fStepSizeY) {
-            float fValuePos = fncDensityPos({fX, fY});
-            float fValueNeg = fncDensityNeg({fX, fY});
-            float fValue = (fValuePos + (1 - fValueNeg))/2;
-           
-
-            ofFile << fX << ", " << fY << ", " << fValue << std::endl;
-            if(maxValue < fValue)
-	    {
-               maxValue = fValue;
-	       maxValueIndX = fX;
-               maxValueIndY = fY;
+	mvg::Grid grdGrid = mvg::Grid::fromBoundingBox(min_x, min_y, max_x, max_y, fStepSizeX, fStepSizeY);
+	mvg::GridRasterizer<double> grsPos(grdGrid);
+	mvg::GridRasterizer<double> grsNeg(grdGrid);
+	grsPos.setTolerance(dRasterTolerance);
+	grsNeg.setTolerance(dRasterTolerance);
+	grsPos.addMixture(mgGaussiansPos);
+	grsNeg.addMixture(mgGaussiansNeg);
+
+	// Tiles of grid rows are rasterized and scored in parallel. Every
+	// tile keeps its first maximum, and the tile maxima are reduced in
+	// tile order, so the result is that of a serial scan.
+	const unsigned int unTileRows = 8;
+	unsigned int unTiles = mvg::Parallel::chunks(grdGrid.unCountX, unTileRows);
+	std::vector<float> vecValues(grdGrid.size());
+	std::vector<float> vecDensitiesNeg(grdGrid.size());
+	std::vector<float> vecTileMax(unTiles, maxValue);
+	std::vector<unsigned int> vecTileMaxCell(unTiles, 0);
+	
+	mvg::Parallel::forRange(grdGrid.unCountX, unTileRows, [&](unsigned int unBegin, unsigned int unEnd) {
+	    unsigned int unTile = unBegin / unTileRows;
+	    unsigned int unFirstCell = unBegin * grdGrid.unCountY;
+	    unsigned int unEndCell = unEnd * grdGrid.unCountY;
+	    
+	    grsPos.rasterizeRows(unBegin, unEnd - unBegin, vecValues.data() + unFirstCell);
+	    grsNeg.rasterizeRows(unBegin, unEnd - unBegin, vecDensitiesNeg.data() + unFirstCell);
+	    
+	    for(unsigned int unCell = unFirstCell; unCell < unEndCell; ++unCell) {
+	      float fValue = (vecValues[unCell] + (1 - vecDensitiesNeg[unCell]))/2;
+	      
+	      vecValues[unCell] = fValue;
+	      if(vecTileMax[unTile] < fValue) {
+		vecTileMax[unTile] = fValue;
+		vecTileMaxCell[unTile] = unCell;
+	      }
 	    }
+	  });
+	
+	for(unsigned int unTile = 0; unTile < unTiles; ++unTile) {
+	  if(maxValue < vecTileMax[unTile]) {
+	    maxValue = vecTileMax[unTile];
+	    maxValueIndX = grdGrid.x(vecTileMaxCell[unTile] / grdGrid.unCountY);
+	    maxValueIndY = grdGrid.y(vecTileMaxCell[unTile] % grdGrid.unCountY);
 	  }
 	}
+	
+	mvg::RasterFile::write(strFileOut, grdGrid, vecValues);
 	jdouble *pMax = env->GetDoubleArrayElements(maximized_expectation, NULL);
         pMax[0] = (double) maxValueIndX;
         pMax[1] = (double) maxValueIndY;
-        ofFile.close();
 	  
         std::cout << maxValueIndX << "-" << maxValueIndY << std::endl;
 	std::cout << "done" << std::endl;
@@ -365,9 +376,9 @@ JNIEXPORT jdoubleArray JNICALL Java_org_knowrob_gaussian_MixedGaussianInterface_
     if(fileExists(strPosFile) & fileExists(strNegFile)) {
       std::cout << "Trial Analysis: '" << strPosFile << "' & '" << strNegFile << "'" << std::endl;
       
-      mvg::Dataset::Ptr dsDataPos = loadCSV(strPosFile, {0, 1, 3});
+      mvg::Dataset::Ptr dsDataPos = mvg::DatasetFile::load(strPosFile, {0, 1, 3});
       std::cout << "Positive Dataset: " << dsDataPos->count() << " samples with " << dsDataPos->dimension() << " dimension" << (dsDataPos->dimension() == 1 ? "" : "s") << std::endl;
-      mvg::Dataset::Ptr dsDataNeg = loadCSV(strNegFile, {0, 1, 3});
+      mvg::Dataset::Ptr dsDataNeg = mvg::DatasetFile::load(strNegFile, {0, 1, 3});
       std::cout << "Negative Dataset: " << dsDataNeg->count() << " samples with " << dsDataNeg->dimension() << " dimension" << (dsDataNeg->dimension() == 1 ? "" : "s") << std::endl;
       
       if(dsDataPos && dsDataNeg) {
@@ -391,42 +402,34 @@ JNIEXPORT jdoubleArray JNICALL Java_org_knowrob_gaussian_MixedGaussianInterface_
 	float maxValueIndX = -1;
 	float maxValueIndY = -1;
        
-        mvg::MultiVarGauss<double>::DensityFunction fncDensityPos = mgGaussiansPos.densityFunction();
-        mvg::MultiVarGauss<double>::DensityFunction fncDensityNeg = mgGaussiansNeg.densityFunction();
-	for(float fX = min_x; fX < max_x; fX += fStepSizeX) {
-	  for(float fY = min_y; fY < max_y; fY += fStepSizeY) {
-            float fValuePos = fncDensityPos({fX, fY});
-            float fValueNeg = fncDensityNeg({fX, fY});
+	mvg::Grid grdGrid = mvg::Grid::fromBoundingBox(min_x, min_y, max_x, max_y, fStepSizeX, fStepSizeY);
+	std::vector<float> vecValues;
+	std::vector<float> vecDensitiesNeg;
+	rasterizeMixture(mgGaussiansPos, grdGrid, vecValues);
+	rasterizeMixture(mgGaussiansNeg, grdGrid, vecDensitiesNeg);
+	
+	for(unsigned int unCell = 0; unCell < grdGrid.size(); ++unCell) {
             float fValue = 0;
-            
-            fValue = (fValuePos + (1- fValueNeg)) / 2;
+	    
+	    fValue = (vecValues[unCell] + (1- vecDensitiesNeg[unCell])) / 2;
 
             if (fValue < 0) fValue = 0;
             if (fValue > 1) fValue = 1;
             if (fValue != fValue) fValue = 0;
             if(maxValue < fValue)
 	       maxValue = fValue;
-	  }
+	    
+	    vecValues[unCell] = fValue;
 	}
         //get a gaussian for maximized locations
         mvg::Dataset::Ptr dsDataMax = mvg::Dataset::create();
-        for(float fX = min_x; fX < max_x; fX += fStepSizeX) {
-	  for(float fY = min_y; fY < max_y; fY += fStepSizeY) {
-            float fValuePos = fncDensityPos({fX, fY});
-            float fValueNeg = fncDensityNeg({fX, fY});
-            float fValue = 0;
-            
-            fValue = (fValuePos + (1- fValueNeg)) / 2;
-
-            if (fValue < 0) fValue = 0;
-            if (fValue > 1) fValue = 1;
-            if (fValue != fValue) fValue = 0;
-
-            if(maxValue == fValue)
+	for(unsigned int unX = 0; unX < grdGrid.unCountX; ++unX) {
+	  for(unsigned int unY = 0; unY < grdGrid.unCountY; ++unY) {
+	    if(maxValue == vecValues[unX * grdGrid.unCountY + unY])
 	    {
                Eigen::VectorXf vxdData(2);
-               vxdData[0] = fX;
-               vxdData[1] = fY;
+	       vxdData[0] = grdGrid.x(unX);
+	       vxdData[1] = grdGrid.y(unY);
                dsDataMax->add(vxdData);
 	    }
           }
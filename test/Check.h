@@ -0,0 +1,26 @@
+#ifndef __CHECK_H__
+#define __CHECK_H__
+
+
+#include <iostream>
+#include <string>
+
+
+// Minimal checks for the test executables: failed checks are reported
+// on std::cerr and counted, `main()` returns `failures()` so that
+// CTest sees a non-zero exit status.
+static unsigned int s_unFailures = 0;
+
+inline void check(bool bCondition, std::string strWhat) {
+  if(!bCondition) {
+    std::cerr << "Failed: " << strWhat << std::endl;
+    s_unFailures++;
+  }
+}
+
+inline int failures() {
+  return (s_unFailures > 0 ? 1 : 0);
+}
+
+
+#endif /* __CHECK_H__ */
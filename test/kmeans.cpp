@@ -0,0 +1,75 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <mvg/Dataset.hpp>
+#include <mvg/KMeans.h>
+
+#include "Check.h"
+
+
+mvg::Dataset::Ptr blobs(unsigned int unSamples, unsigned int unDimension, unsigned int unBlobs, unsigned long ulSeed) {
+  // Overlapping Gaussian blobs, so that the iterations have borders to
+  // settle
+  std::mt19937 mtEngine(ulSeed);
+  std::normal_distribution<float> ndNormal(0.0f, 1.0f);
+  std::uniform_real_distribution<float> udCenter(-3.0f, 3.0f);
+  Eigen::MatrixXf mxCenters(unDimension, unBlobs);
+  mvg::Dataset::Ptr dsData = mvg::Dataset::create(unDimension);
+  
+  for(unsigned int unI = 0; unI < mxCenters.size(); ++unI) {
+    mxCenters.data()[unI] = udCenter(mtEngine);
+  }
+  
+  for(unsigned int unI = 0; unI < unSamples; ++unI) {
+    Eigen::VectorXf vxSample = mxCenters.col(unI % unBlobs);
+    
+    for(unsigned int unDim = 0; unDim < unDimension; ++unDim) {
+      vxSample[unDim] += ndNormal(mtEngine);
+    }
+    
+    dsData->add(vxSample);
+  }
+  
+  return dsData;
+}
+
+mvg::KMeans::Clustering cluster(mvg::Dataset::Ptr dsData, mvg::KMeans::Algorithm algAlgorithm, unsigned int unClusters, unsigned long ulSeed) {
+  mvg::KMeans kmMeans;
+  
+  kmMeans.setSource(dsData);
+  kmMeans.setAlgorithm(algAlgorithm);
+  kmMeans.setSeed(ulSeed);
+  kmMeans.calculate(unClusters);
+  
+  return kmMeans.clustering();
+}
+
+void compare(mvg::KMeans::Clustering& clReference, mvg::KMeans::Clustering& clOther, std::string strWhat) {
+  check(clOther.vecLabels == clReference.vecLabels, strWhat + ": labels");
+  check(clOther.mxCentroids.rows() == clReference.mxCentroids.rows() && clOther.mxCentroids.cols() == clReference.mxCentroids.cols() &&
+	(clOther.mxCentroids - clReference.mxCentroids).cwiseAbs().maxCoeff() < 1e-4, strWhat + ": centroids");
+}
+
+
+// The exact accelerations (Hamerly, k-d tree filtering) have to
+// reproduce Lloyd's clustering from the same initial centroids.
+int main() {
+  for(unsigned int unDimension : {2, 3, 5}) {
+    mvg::Dataset::Ptr dsData = blobs(20000, unDimension, 6, unDimension);
+    
+    for(unsigned long ulSeed : {1, 2, 3}) {
+      std::string strCase = std::to_string(unDimension) + "D, seed " + std::to_string(ulSeed);
+      mvg::KMeans::Clustering clLloyd = cluster(dsData, mvg::KMeans::Lloyd, 6, ulSeed);
+      mvg::KMeans::Clustering clHamerly = cluster(dsData, mvg::KMeans::Hamerly, 6, ulSeed);
+      mvg::KMeans::Clustering clFiltering = cluster(dsData, mvg::KMeans::Filtering, 6, ulSeed);
+      
+      compare(clLloyd, clHamerly, "Hamerly, " + strCase);
+      compare(clLloyd, clFiltering, "Filtering, " + strCase);
+    }
+  }
+  
+  return failures();
+}
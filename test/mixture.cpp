@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <mvg/Dataset.hpp>
+#include <mvg/KMeans.h>
+#include <mvg/MixedGaussians.hpp>
+#include <mvg/Parallel.h>
+
+#include "Check.h"
+
+
+mvg::Dataset::Ptr blobs(unsigned int unDimension, std::mt19937& mtEngine) {
+  // Three Gaussian blobs of different spreads
+  std::normal_distribution<float> ndNormal(0.0f, 1.0f);
+  mvg::Dataset::Ptr dsData = mvg::Dataset::create(unDimension);
+  
+  for(unsigned int unI = 0; unI < 6000; ++unI) {
+    Eigen::VectorXf vxSample(unDimension);
+    
+    for(unsigned int unDim = 0; unDim < unDimension; ++unDim) {
+      vxSample[unDim] = (unI % 3) * ((unDim % 2) ? -1.5f : 2.0f) + (0.3f + 0.2f * (unI % 3)) * ndNormal(mtEngine);
+    }
+    
+    dsData->add(vxSample);
+  }
+  
+  return dsData;
+}
+
+template<int Dim>
+  void compareFixed(std::mt19937& mtEngine) {
+  // A fixed dimension only changes the Eigen types the models are kept
+  // in, not the fitted mixture or its densities.
+  std::string strCase = std::to_string(Dim) + "D: ";
+  mvg::Dataset::Ptr dsData = blobs(Dim, mtEngine);
+  mvg::Dataset::Ptr dsPoints = blobs(Dim, mtEngine);
+  mvg::KMeans kmMeans;
+  
+  kmMeans.setSource(dsData);
+  kmMeans.setSeed(1);
+  kmMeans.calculate(3);
+  
+  mvg::MixedGaussians<double> mgDynamic;
+  typename mvg::MixedGaussians<double, Dim>::Ptr mgFixed = mvg::MixedGaussians<double, Dim>::create();
+  
+  check(mgDynamic.fit(kmMeans.clusters()), strCase + "fit");
+  check(mgFixed->fit(kmMeans.clusters()), strCase + "fixed fit");
+  
+  unsigned int unPoints = dsPoints->count();
+  std::vector<float> vecDynamic(unPoints);
+  std::vector<float> vecFixed(unPoints);
+  std::vector<float> vecLogDynamic(unPoints);
+  std::vector<float> vecLogFixed(unPoints);
+  
+  mgDynamic.densities(dsPoints->data(), unPoints, Dim, vecDynamic.data());
+  mgFixed->densities(dsPoints->data(), unPoints, Dim, vecFixed.data());
+  mgDynamic.logDensities(dsPoints->data(), unPoints, Dim, vecLogDynamic.data());
+  mgFixed->logDensities(dsPoints->data(), unPoints, Dim, vecLogFixed.data());
+  
+  float fWorst = 0.0f;
+  float fWorstLog = 0.0f;
+  float fWorstSample = 0.0f;
+  
+  for(unsigned int unI = 0; unI < unPoints; ++unI) {
+    std::vector<double> vecPoint(dsPoints->data() + (size_t)unI * Dim, dsPoints->data() + (size_t)(unI + 1) * Dim);
+    
+    fWorst = std::max(fWorst, std::abs(vecFixed[unI] - vecDynamic[unI]) / std::max(vecDynamic[unI], 1e-30f));
+    fWorstLog = std::max(fWorstLog, std::abs(vecLogFixed[unI] - vecLogDynamic[unI]));
+    fWorstSample = std::max(fWorstSample, std::abs((float)mgFixed->sample(vecPoint) - vecDynamic[unI]) / std::max(vecDynamic[unI], 1e-30f));
+  }
+  
+  check(fWorst < 1e-3f, strCase + "densities");
+  check(fWorstLog < 1e-3f, strCase + "log densities");
+  check(fWorstSample < 1e-3f, strCase + "samples");
+}
+
+
+// EM never lowers the log-likelihood (up to float evaluation noise),
+// and gives the same mixture for any thread count and for a fixed
+// dimension.
+int main() {
+  std::mt19937 mtEngine(5);
+  std::normal_distribution<float> ndNormal(0.0f, 1.0f);
+  std::uniform_real_distribution<float> udUniform(0.0f, 1.0f);
+  mvg::Dataset::Ptr dsData = mvg::Dataset::create(2);
+  
+  for(unsigned int unI = 0; unI < 20000; ++unI) {
+    Eigen::VectorXf vxSample(2);
+    float fChoice = udUniform(mtEngine);
+    
+    if(fChoice < 0.5f) {
+      vxSample << 0.5f * ndNormal(mtEngine), 0.2f * ndNormal(mtEngine);
+    } else if(fChoice < 0.8f) {
+      vxSample << 1.0f + 0.3f * ndNormal(mtEngine), 0.5f + 0.6f * ndNormal(mtEngine);
+    } else {
+      vxSample << -1.0f + 0.2f * ndNormal(mtEngine), 1.0f + 0.2f * ndNormal(mtEngine);
+    }
+    
+    dsData->add(vxSample);
+  }
+  
+  mvg::KMeans kmMeans;
+  kmMeans.setSource(dsData);
+  kmMeans.setSeed(1);
+  kmMeans.calculate(3);
+  
+  std::vector<std::vector<double>> vecRuns;
+  
+  for(unsigned int unThreads : {1, 4}) {
+    mvg::Parallel::setThreads(unThreads);
+    
+    mvg::MixedGaussians<double> mgGaussians;
+    check(mgGaussians.fit(kmMeans.clusters()), "fit");
+    
+    std::vector<double>& vecLogLikelihoods = mgGaussians.logLikelihoods();
+    check(vecLogLikelihoods.size() > 1, "iterations");
+    
+    for(unsigned int unI = 1; unI < vecLogLikelihoods.size(); ++unI) {
+      check(vecLogLikelihoods[unI] >= vecLogLikelihoods[unI - 1] - 1e-6, "log-likelihood of iteration " + std::to_string(unI));
+    }
+    
+    double dWeightSum = 0.0;
+    for(mvg::MixedGaussians<double>::Gaussian& gsGaussian : mgGaussians.gaussians()) {
+      dWeightSum += gsGaussian.dWeight;
+    }
+    
+    check(std::abs(dWeightSum - 1.0) < 1e-4, "weights sum");
+    
+    vecRuns.push_back(vecLogLikelihoods);
+  }
+  
+  check(vecRuns[0] == vecRuns[1], "same log-likelihoods for 1 and 4 threads");
+  
+  compareFixed<2>(mtEngine);
+  compareFixed<4>(mtEngine);
+  
+  return failures();
+}
@@ -0,0 +1,51 @@
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <mvg/Random.h>
+
+#include "Check.h"
+
+
+// Alias table draws have to follow the (unnormalized) weights: every
+// frequency within five standard deviations of its expectation, and
+// zero weights never drawn.
+int main() {
+  const unsigned int unDraws = 1000000;
+  std::vector<double> vecWeights = {1.0, 0.0, 2.0, 3.5, 0.5, 0.001};
+  double dWeightSum = 0.0;
+  
+  for(double dWeight : vecWeights) {
+    dWeightSum += dWeight;
+  }
+  
+  mvg::AliasTable atTable(vecWeights);
+  mvg::Random rndRandom(42);
+  std::vector<unsigned int> vecCounts(vecWeights.size(), 0);
+  
+  check(atTable.size() == vecWeights.size(), "size");
+  
+  for(unsigned int unI = 0; unI < unDraws; ++unI) {
+    unsigned int unDrawn = atTable.draw(rndRandom);
+    
+    if(unDrawn < vecCounts.size()) {
+      vecCounts[unDrawn]++;
+    } else {
+      check(false, "drawn index " + std::to_string(unDrawn));
+    }
+  }
+  
+  for(unsigned int unI = 0; unI < vecWeights.size(); ++unI) {
+    double dProbability = vecWeights[unI] / dWeightSum;
+    double dExpected = dProbability * unDraws;
+    double dDeviation = std::sqrt(dExpected * (1.0 - dProbability));
+    
+    if(vecWeights[unI] == 0.0) {
+      check(vecCounts[unI] == 0, "zero weight " + std::to_string(unI) + " drawn");
+    } else {
+      check(std::abs(vecCounts[unI] - dExpected) <= 5.0 * dDeviation, "frequency of " + std::to_string(unI));
+    }
+  }
+  
+  return failures();
+}
@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <mvg/Grid.hpp>
+#include <mvg/GridRasterizer.hpp>
+#include <mvg/MultiVarGauss.hpp>
+
+#include "Check.h"
+
+
+// Culling far away terms per tile must stay within the relative error
+// bound the rasterizer reports, against rasterizing every term.
+int main() {
+  std::mt19937 mtEngine(11);
+  std::uniform_real_distribution<double> udPosition(0.0, 10.0);
+  std::uniform_real_distribution<double> udSpread(0.05, 0.5);
+  std::uniform_real_distribution<double> udWeight(0.1, 1.0);
+  mvg::Grid grdGrid = mvg::Grid::fromBoundingBox(0.0f, 0.0f, 10.0f, 10.0f, 0.02f, 0.02f);
+  mvg::GridRasterizer<double> grsExact(grdGrid);
+  mvg::GridRasterizer<double> grsCulled(grdGrid);
+  std::vector<mvg::MultiVarGauss<double>> vecGaussians(40);
+  
+  grsCulled.setTolerance(1e-4);
+  
+  for(mvg::MultiVarGauss<double>& mvgGaussian : vecGaussians) {
+    Eigen::Vector2d vxMean(udPosition(mtEngine), udPosition(mtEngine));
+    Eigen::Vector2d vxSpreads(udSpread(mtEngine), udSpread(mtEngine));
+    double dCorrelation = 0.8 * (udWeight(mtEngine) - 0.5);
+    Eigen::Matrix2d mxCovariance;
+    double dWeight = udWeight(mtEngine);
+    
+    mxCovariance << vxSpreads[0] * vxSpreads[0], dCorrelation * vxSpreads[0] * vxSpreads[1],
+      dCorrelation * vxSpreads[0] * vxSpreads[1], vxSpreads[1] * vxSpreads[1];
+    
+    mvgGaussian.setParameters(vxMean, mxCovariance);
+    grsExact.addGaussian(mvgGaussian, dWeight);
+    grsCulled.addGaussian(mvgGaussian, dWeight);
+  }
+  
+  std::vector<float> vecExact;
+  std::vector<float> vecCulled;
+  grsExact.rasterize(vecExact);
+  grsCulled.rasterize(vecCulled);
+  
+  double dErrorBound = grsCulled.errorBound();
+  double dWorst = 0.0;
+  
+  check(grsExact.errorBound() == 0.0, "error bound without tolerance");
+  check(dErrorBound > 0.0, "terms culled");
+  
+  for(unsigned int unCell = 0; unCell < grdGrid.size(); ++unCell) {
+    if(vecExact[unCell] > 0.0f) {
+      dWorst = std::max(dWorst, std::abs((double)vecCulled[unCell] - vecExact[unCell]) / vecExact[unCell]);
+    }
+  }
+  
+  // Float summation noise on top of the bound
+  check(dWorst <= dErrorBound + 1e-5, "relative error " + std::to_string(dWorst) + " within bound " + std::to_string(dErrorBound));
+  
+  return failures();
+}
@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <mvg/Statistics.hpp>
+
+#include "Check.h"
+
+
+// Single pass statistics (sample by sample, in blocks and merged) have
+// to agree with the two-pass mean and covariance, also for samples far
+// away from the origin.
+int main() {
+  const unsigned int unSamples = 10000;
+  const unsigned int unDimension = 3;
+  std::mt19937 mtEngine(3);
+  std::normal_distribution<float> ndNormal(0.0f, 1.0f);
+  Eigen::MatrixXf mxSamples(unDimension, unSamples);
+  
+  for(unsigned int unI = 0; unI < unSamples; ++unI) {
+    float fX = ndNormal(mtEngine);
+    float fY = ndNormal(mtEngine);
+    float fZ = ndNormal(mtEngine);
+    
+    mxSamples.col(unI) << 10000.0f + 2.0f * fX, -500.0f + fX + 0.5f * fY, 0.1f * fZ;
+  }
+  
+  Eigen::MatrixXd mxData = mxSamples.cast<double>();
+  Eigen::VectorXd vxMean = mxData.rowwise().mean();
+  Eigen::MatrixXd mxCentered = mxData.colwise() - vxMean;
+  Eigen::MatrixXd mxCovariance = mxCentered * mxCentered.transpose() / (double)unSamples;
+  
+  mvg::Statistics stSingle;
+  mvg::Statistics stBlocks;
+  mvg::Statistics stFirst;
+  mvg::Statistics stSecond;
+  
+  for(unsigned int unI = 0; unI < unSamples; ++unI) {
+    stSingle.add(mxSamples.col(unI));
+    (unI < unSamples / 3 ? stFirst : stSecond).add(mxSamples.col(unI));
+  }
+  
+  for(unsigned int unStart = 0; unStart < unSamples; unStart += 777) {
+    stBlocks.addBlock(mxSamples.middleCols(unStart, std::min(777u, unSamples - unStart)));
+  }
+  
+  stFirst.merge(stSecond);
+  
+  mvg::Statistics* pstStatistics[] = {&stSingle, &stBlocks, &stFirst};
+  std::string strNames[] = {"single samples", "blocks", "merged"};
+  
+  for(unsigned int unI = 0; unI < 3; ++unI) {
+    mvg::Statistics& stStatistics = *pstStatistics[unI];
+    
+    check(stStatistics.count() == unSamples, strNames[unI] + ": count");
+    check((stStatistics.mean() - vxMean).norm() < 1e-9 * vxMean.norm(), strNames[unI] + ": mean");
+    check((stStatistics.covariance() - mxCovariance).norm() < 1e-8 * mxCovariance.norm(), strNames[unI] + ": covariance");
+    check(stStatistics.minimum() == mxData.rowwise().minCoeff(), strNames[unI] + ": minimum");
+    check(stStatistics.maximum() == mxData.rowwise().maxCoeff(), strNames[unI] + ": maximum");
+  }
+  
+  return failures();
+}